@@ -1,9 +1,21 @@
 #include <algorithm> 
 #include <array>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
 #include <chrono>
+#include <memory>
 #include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "ColumnStore.h"
+#include "Convergence.h"
+#include "JobRuntime.h"
+#include "Trace.h"
 
 namespace Random
 {
@@ -47,6 +59,15 @@ namespace Rules
 {
     constexpr int maxScore{ 21 };       // maximum losing score
     constexpr int dealerLimit{ 17 };    // minium dealer score
+    constexpr int maxSeats{ 7 };        // player seats at one table
+    constexpr int shoeDecks{ 6 };       // decks in a table shoe
+    constexpr double penetration{ 0.75 }; // share of the shoe dealt before reshuffling
+
+    // A hand stops at a hard total of 20 or less plus one card, 30 at most,
+    // and a deck holds 340 points with aces as one, so a full table never
+    // uses up a single deck in one round and a shoe can always be refilled
+    // from the discards (see Shoe::draw)
+    static_assert((maxSeats + 1) * 30 < 340);
 }
 
 struct Card
@@ -135,6 +156,7 @@ public:
     }
 
     int score() const { return m_total; }
+    bool soft() const { return m_softAces > 0; }
 };
 
 bool askPlayerHit()
@@ -143,7 +165,7 @@ bool askPlayerHit()
     while (true)
     {
         std::cout << "(h)it or (s)tand? ";
-        std::cin >> choice;
+        Trace::read("hit or stand", choice);
 
         if (choice == 'h') return true;
         if (choice == 's') return false;
@@ -214,8 +236,936 @@ Result playGame()
     return (player.score() > dealer.score() ? Result::PlayerWin : Result::DealerWin);
 }
 
-int main()
+// Several decks shuffled together and dealt down to the cut card, so the
+// cards seen in one round change the odds of the next
+class Shoe
+{
+    std::vector<Card> m_cards{};
+    std::size_t m_index{0};
+    std::size_t m_cut{0};
+    std::size_t m_roundStart{0};   // first card dealt in the current round
+
+public:
+    Shoe(int decks, double penetration)
+    {
+        m_cards.reserve(static_cast<std::size_t>(decks) * 52);
+        for (int d = 0; d < decks; ++d)
+            for (auto s : Card::allSuits)
+                for (auto r : Card::allRanks)
+                    m_cards.push_back(Card{r, s});
+        m_cut = static_cast<std::size_t>(static_cast<double>(m_cards.size()) * penetration);
+    }
+
+    template <typename Rng>
+    void shuffle(Rng& rng)
+    {
+        std::shuffle(m_cards.begin(), m_cards.end(), rng);
+        m_index = 0;
+        m_roundStart = 0;
+    }
+
+    bool pastCut() const { return m_index >= m_cut; }
+
+    // the cards dealt from now on belong to a new round
+    void startRound() { m_roundStart = m_index; }
+
+    // A shoe that runs out in the middle of a round is refilled the way a
+    // dealer does it: the discards of the earlier rounds are shuffled and
+    // dealt, the cards on the table stay where they are
+    template <typename Rng>
+    Card draw(Rng& rng)
+    {
+        if (m_index == m_cards.size())
+        {
+            assert(m_roundStart > 0);
+            std::rotate(m_cards.begin(), m_cards.begin() + static_cast<std::ptrdiff_t>(m_roundStart), m_cards.end());
+            m_index = m_cards.size() - m_roundStart;
+            m_roundStart = 0;
+            std::shuffle(m_cards.begin() + static_cast<std::ptrdiff_t>(m_index), m_cards.end(), rng);
+        }
+        return m_cards[m_index++];
+    }
+};
+
+// Hit/stand decision of a seat given its hand and the dealer's up card
+using Policy = bool (*)(const Player& hand, const Card& up);
+
+namespace Policies
+{
+    // hit/stand part of basic strategy (no doubling or splitting here)
+    bool basic(const Player& hand, const Card& up)
+    {
+        int s{ hand.score() };
+        int u{ up.value() };
+        if (hand.soft())
+            return s <= 17 || (s == 18 && u >= 9);
+        if (s <= 11) return true;
+        if (s == 12) return u < 4 || u > 6;
+        if (s <= 16) return u > 6;
+        return false;
+    }
+
+    // draws to 17 like the dealer
+    bool dealer(const Player& hand, const Card&) { return hand.score() < Rules::dealerLimit; }
+
+    // never risks a bust
+    bool safe(const Player& hand, const Card&) { return hand.score() < 12; }
+
+    // stands on 15 and above
+    bool stand15(const Player& hand, const Card&) { return hand.score() < 15; }
+
+    struct Named
+    {
+        std::string_view name;
+        Policy policy;
+    };
+
+    constexpr std::array all{
+        Named{"basic", basic}, Named{"dealer", dealer}, Named{"safe", safe}, Named{"stand15", stand15}
+    };
+
+    Policy find(std::string_view name)
+    {
+        for (const auto& p : all)
+            if (p.name == name)
+                return p.policy;
+        return nullptr;
+    }
+}
+
+// outcome of a seat's hand, as stored in the result column
+enum class SeatResult : std::uint8_t { win, tie, loss, bust };
+
+struct SeatStats
+{
+    std::uint64_t hands{0};
+    std::uint64_t wins{0};
+    std::uint64_t ties{0};
+    std::uint64_t busts{0};
+
+    void merge(const SeatStats& o)
+    {
+        hands += o.hands;
+        wins += o.wins;
+        ties += o.ties;
+        busts += o.busts;
+    }
+
+    std::uint64_t losses() const { return hands - wins - ties; }
+};
+
+// One table: up to seven policy-driven seats and the dealer around a
+// persistent shoe. Each table owns its generator, so the result of a run
+// depends on the seed and not on how tables are spread over threads
+class Table
+{
+    Shoe m_shoe;
+    std::mt19937 m_rng;
+    const std::vector<Policy>* m_seats;
+    bool m_freshShoe;
+    std::array<Player, Rules::maxSeats> m_hands{};
+    std::array<SeatResult, Rules::maxSeats> m_results{};
+    int m_dealerScore{0};
+
+public:
+    Table(const std::vector<Policy>& seats, int decks, bool freshShoe, std::seed_seq& seed)
+        : m_shoe{decks, Rules::penetration}, m_rng{seed}, m_seats{&seats}, m_freshShoe{freshShoe}
+    {
+        m_shoe.shuffle(m_rng);
+    }
+
+    // plays one round in seat order and adds the outcome of every seat to stats
+    void playRound(SeatStats* stats)
+    {
+        if (m_freshShoe || m_shoe.pastCut())
+            m_shoe.shuffle(m_rng);
+        m_shoe.startRound();
+
+        const std::size_t seats{ m_seats->size() };
+        for (std::size_t i = 0; i < seats; ++i)
+            m_hands[i] = Player{};
+
+        // one card to every seat, the dealer's up card, then the second round
+        for (std::size_t i = 0; i < seats; ++i)
+            m_hands[i].takeCard(m_shoe.draw(m_rng));
+        Card up{ m_shoe.draw(m_rng) };
+        Player dealer;
+        dealer.takeCard(up);
+        for (std::size_t i = 0; i < seats; ++i)
+            m_hands[i].takeCard(m_shoe.draw(m_rng));
+
+        bool anyStanding{false};
+        for (std::size_t i = 0; i < seats; ++i)
+        {
+            Player& hand{ m_hands[i] };
+            while (hand.score() < Rules::maxScore && (*m_seats)[i](hand, up))
+                hand.takeCard(m_shoe.draw(m_rng));
+            anyStanding |= hand.score() <= Rules::maxScore;
+        }
+
+        // the dealer only draws if someone is still in the round
+        if (anyStanding)
+            while (dealer.score() < Rules::dealerLimit)
+                dealer.takeCard(m_shoe.draw(m_rng));
+
+        m_dealerScore = dealer.score();
+        for (std::size_t i = 0; i < seats; ++i)
+        {
+            int s{ m_hands[i].score() };
+            SeatStats& st{ stats[i] };
+            ++st.hands;
+            if (s > Rules::maxScore)
+            {
+                ++st.busts;
+                m_results[i] = SeatResult::bust;
+            }
+            else if (dealer.score() > Rules::maxScore || s > dealer.score())
+            {
+                ++st.wins;
+                m_results[i] = SeatResult::win;
+            }
+            else if (s == dealer.score())
+            {
+                ++st.ties;
+                m_results[i] = SeatResult::tie;
+            }
+            else
+                m_results[i] = SeatResult::loss;
+        }
+    }
+
+    std::size_t seats() const { return m_seats->size(); }
+    SeatResult result(std::size_t seat) const { return m_results[seat]; }
+    int score(std::size_t seat) const { return m_hands[seat].score(); }
+    int dealerScore() const { return m_dealerScore; }
+};
+
+// Columns of a stored run: one row per seat and round. A table's generator
+// is seeded from (run seed, table), so a row is reproduced by replaying
+// its table up to the round
+struct HandColumns
+{
+    Columns::Schema schema{};
+    int table{ schema.add("table", Columns::Type::u32) };
+    int round{ schema.add("round", Columns::Type::u32) };
+    int seat{ schema.add("seat", Columns::Type::u8) };
+    int result{ schema.add("result", Columns::Type::u8) };
+    int score{ schema.add("score", Columns::Type::u8) };
+    int dealer{ schema.add("dealer", Columns::Type::u8) };
+
+    // appends the last round of a table, false if the segment cannot grow
+    bool store(Columns::Writer& out, const Table& t, std::uint32_t tableNo, std::uint32_t roundNo) const
+    {
+        for (std::size_t i = 0; i < t.seats(); ++i)
+        {
+            if (!out.append())
+                return false;
+            out.set(table, tableNo);
+            out.set(round, roundNo);
+            out.set(seat, static_cast<std::uint8_t>(i));
+            out.set(result, static_cast<std::uint8_t>(t.result(i)));
+            out.set(score, static_cast<std::uint8_t>(t.score(i)));
+            out.set(dealer, static_cast<std::uint8_t>(t.dealerScore()));
+        }
+        return true;
+    }
+};
+
+struct TableRun
+{
+    std::vector<Policy> seats{};
+    std::vector<std::string> seatNames{};
+    int tables{1000};
+    int rounds{1000};
+    int threads{ static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };
+    int decks{0};              // 0: Rules::shoeDecks, or one deck with freshShoe
+    bool freshShoe{false};
+    std::uint32_t seed{1};
+    std::string store{};   // path of the results store, empty to keep only totals
+};
+
+// Runs every table for the given number of rounds. Tables are dealt out
+// in blocks of blockTables to the workers of the job runtime; a worker
+// plays round r on all tables of its block before moving on to round r + 1
+// and counts into its own buffer, which is merged once the job is done.
+// With a store set, every worker also appends its hands to its own segment
+// of the store
+constexpr int blockTables{ 8 };
+
+std::vector<SeatStats> simulateTables(const TableRun& run, bool* stored = nullptr)
+{
+    const std::size_t seats{ run.seats.size() };
+    const int blocks{ (run.tables + blockTables - 1) / blockTables };
+    Jobs::Runtime runtime{ std::min(run.threads, blocks) };
+    Jobs::PerWorker<std::vector<SeatStats>> local{ runtime, std::vector<SeatStats>(seats) };
+    Jobs::PerWorker<std::unique_ptr<Columns::Writer>> out{ runtime };
+    Jobs::PerWorker<char> storeOk{ runtime, 1 };
+    const HandColumns columns;
+    if (!run.store.empty())
+    {
+        Columns::clear(run.store);
+        for (int w = 0; w < runtime.workers(); ++w)
+            out[w] = std::make_unique<Columns::Writer>(Columns::segmentPath(run.store, w), columns.schema, run.seed);
+    }
+
+    runtime.parallelFor(static_cast<std::size_t>(blocks), [&](std::size_t block, int worker) {
+        const int first{ static_cast<int>(block) * blockTables };
+        const int last{ std::min(run.tables, first + blockTables) };
+
+        std::vector<Table> batch;
+        batch.reserve(static_cast<std::size_t>(last - first));
+        for (int i = first; i < last; ++i)
+        {
+            std::seed_seq seq{ run.seed, static_cast<std::uint32_t>(i) };
+            batch.emplace_back(run.seats, run.decks, run.freshShoe, seq);
+        }
+
+        SeatStats* stats{ local[worker].data() };
+        if (run.store.empty())
+        {
+            for (int r = 0; r < run.rounds; ++r)
+                for (auto& table : batch)
+                    table.playRound(stats);
+            return;
+        }
+
+        Columns::Writer& writer{ *out[worker] };
+        bool ok{ writer.ok() };
+        for (int r = 0; r < run.rounds; ++r)
+        {
+            for (std::size_t i = 0; i < batch.size(); ++i)
+            {
+                batch[i].playRound(stats);
+                ok = ok && columns.store(writer, batch[i], static_cast<std::uint32_t>(first) + static_cast<std::uint32_t>(i),
+                                        static_cast<std::uint32_t>(r));
+            }
+        }
+        storeOk[worker] &= static_cast<char>(ok);
+    });
+
+    // a worker that ran no block leaves an empty segment
+    bool allStored{true};
+    for (int w = 0; w < runtime.workers(); ++w)
+        if (out[w])
+            allStored = out[w]->close() && storeOk[w] && allStored;
+    if (stored)
+        *stored = allStored;
+
+    std::vector<SeatStats> total(seats);
+    local.forEach([&](const std::vector<SeatStats>& part) {
+        for (std::size_t i = 0; i < part.size(); ++i)
+            total[i].merge(part[i]);
+    });
+    return total;
+}
+
+// comma-separated policy names, e.g. basic,dealer,safe
+bool parsePolicies(const std::string& list, std::vector<Policy>& policies, std::vector<std::string>& names)
 {
+    std::size_t start{0};
+    while (start <= list.size())
+    {
+        std::size_t comma{ std::min(list.find(',', start), list.size()) };
+        std::string name{ list.substr(start, comma - start) };
+        Policy p{ Policies::find(name) };
+        if (!p)
+        {
+            std::cerr << "Unknown policy " << name << " (known:";
+            for (const auto& n : Policies::all)
+                std::cerr << ' ' << n.name;
+            std::cerr << ")\n";
+            return false;
+        }
+        policies.push_back(p);
+        names.push_back(name);
+        start = comma + 1;
+    }
+    return true;
+}
+
+int simulationMain(int argc, char* argv[])
+{
+    TableRun run;
+    std::string seatList{"basic"};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg{ argv[i] };
+        if (arg == "--fresh")
+        {
+            run.freshShoe = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << '\n';
+            return 1;
+        }
+        std::string value{ argv[++i] };
+        if (arg == "--seats") seatList = value;
+        else if (arg == "--tables") run.tables = std::stoi(value);
+        else if (arg == "--rounds") run.rounds = std::stoi(value);
+        else if (arg == "--threads") run.threads = std::stoi(value);
+        else if (arg == "--decks") run.decks = std::stoi(value);
+        else if (arg == "--seed") run.seed = static_cast<std::uint32_t>(std::stoul(value));
+        else if (arg == "--store") run.store = value;
+        else
+        {
+            std::cerr << "Unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+
+    if (!parsePolicies(seatList, run.seats, run.seatNames))
+        return 1;
+
+    // --fresh alone is the old model of one deck shuffled for every game
+    if (run.decks == 0)
+        run.decks = run.freshShoe ? 1 : Rules::shoeDecks;
+
+    if (run.seats.size() > static_cast<std::size_t>(Rules::maxSeats) || run.tables < 1 || run.rounds < 1
+        || run.decks < 1)
+    {
+        std::cerr << "Need 1-" << Rules::maxSeats << " seats, at least one table, round and deck\n";
+        return 1;
+    }
+
+    auto begin{ std::chrono::steady_clock::now() };
+    bool stored{false};
+    std::vector<SeatStats> stats{ simulateTables(run, &stored) };
+    std::chrono::duration<double> took{ std::chrono::steady_clock::now() - begin };
+
+    std::uint64_t hands{0};
+    std::cout << "seat  policy      hands      win%    tie%   loss%   bust%   net/hand\n";
+    std::cout << std::fixed;
+    for (std::size_t i = 0; i < stats.size(); ++i)
+    {
+        const SeatStats& s{ stats[i] };
+        double n{ static_cast<double>(s.hands) };
+        hands += s.hands;
+        std::cout << std::setw(4) << i + 1 << "  " << std::left << std::setw(8) << run.seatNames[i] << std::right
+                  << std::setw(11) << s.hands << std::setprecision(2)
+                  << std::setw(10) << 100.0 * static_cast<double>(s.wins) / n
+                  << std::setw(8) << 100.0 * static_cast<double>(s.ties) / n
+                  << std::setw(8) << 100.0 * static_cast<double>(s.losses()) / n
+                  << std::setw(8) << 100.0 * static_cast<double>(s.busts) / n << std::setprecision(4)
+                  << std::setw(11) << (static_cast<double>(s.wins) - static_cast<double>(s.losses())) / n << '\n';
+    }
+    std::cout << std::setprecision(2) << '\n' << run.tables << " tables x " << run.rounds << " rounds, "
+              << std::to_string(run.decks) << "-deck shoe" << (run.freshShoe ? " shuffled every round" : "")
+              << ", " << took.count() << " s, " << static_cast<double>(hands) / took.count() / 1e6 << " M hands/s\n";
+
+    if (!run.store.empty())
+    {
+        if (!stored)
+        {
+            std::cerr << "Could not write the store " << Columns::segmentPath(run.store, 0) << '\n';
+            return 1;
+        }
+        std::cout << "hands stored in " << Columns::segmentPath(run.store, 0) << " and following segments\n";
+    }
+    return 0;
+}
+
+// Comparison of policies heads-up against the dealer with a fresh deck for
+// every hand, as in playGame(). The estimates are the mean net result per
+// hand (+1 win, 0 tie, -1 loss) of every policy and its difference from
+// the first one. Three variance reduction techniques can be switched on:
+//  - common random numbers: all policies play the same deck order, so
+//    their differences only come from their decisions
+//  - antithetic decks: every shuffle is paired with a mirrored one built
+//    from the same random numbers, and the pair is one sample
+//  - stratification on the dealer's up card: every rank is the up card in
+//    the same number of samples, which removes the variance between ranks
+// Samples are dealt in chunks with their own seeds, so the result does not
+// depend on the number of threads.
+namespace Variance
+{
+    constexpr int strata{ Card::totalRanks };
+    constexpr long chunkSamples{ 4096 };
+
+    struct Moments
+    {
+        double n{0};
+        double sum{0};
+        double sumSq{0};
+
+        void add(double x)
+        {
+            n += 1;
+            sum += x;
+            sumSq += x * x;
+        }
+
+        void merge(const Moments& o)
+        {
+            n += o.n;
+            sum += o.sum;
+            sumSq += o.sumSq;
+        }
+
+        double mean() const { return n > 0 ? sum / n : 0.0; }
+        double meanSq() const { return n > 0 ? sumSq / n : 0.0; }
+        double variance() const { return n > 1 ? (sumSq - sum * sum / n) / (n - 1) : 0.0; }
+    };
+
+    struct CompareRun
+    {
+        std::vector<Policy> policies{};
+        std::vector<std::string> names{};
+        long hands{1000000};   // per policy
+        int threads{ static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };
+        std::uint32_t seed{1};
+        bool common{false};
+        bool antithetic{false};
+        bool stratified{false};
+        double width{0};    // stop at this 95% CI half-width of the first policy's mean, 0 to play every hand
+        double report{0};   // seconds between live reports, 0 for none
+    };
+
+    // per policy and stratum
+    struct Tally
+    {
+        std::vector<std::array<Moments, strata>> sample{};   // one value per sample
+        std::vector<std::array<Moments, strata>> hand{};     // one value per hand
+        std::vector<std::array<Moments, strata>> diff{};     // sample minus the first policy's (common numbers)
+
+        explicit Tally(std::size_t policies) : sample(policies), hand(policies), diff(policies) {}
+
+        void merge(const Tally& o)
+        {
+            for (std::size_t k = 0; k < sample.size(); ++k)
+            {
+                for (int s = 0; s < strata; ++s)
+                {
+                    sample[k][s].merge(o.sample[k][s]);
+                    hand[k][s].merge(o.hand[k][s]);
+                    diff[k][s].merge(o.diff[k][s]);
+                }
+            }
+        }
+    };
+
+    struct Estimate
+    {
+        double mean{};
+        double variance{};       // of the mean
+        double handVariance{};   // of one hand without variance reduction
+
+        double halfWidth() const { return 1.96 * std::sqrt(variance); }
+
+        // hands of plain sampling that give the same precision
+        double effectiveHands() const { return variance > 0 ? handVariance / variance : 0.0; }
+    };
+
+    struct CompareResult
+    {
+        std::vector<Estimate> policy{};
+        std::vector<Estimate> diff{};   // diff[k] is policy k minus policy 0
+        double seconds{};
+        long hands{};                   // played per policy
+    };
+
+    // Random choices of a forward Fisher-Yates shuffle, drawn when a deck
+    // first needs them, so that several decks can replay the same shuffle
+    class Swaps
+    {
+        std::array<int, 52> m_pick{};
+        std::size_t m_drawn{0};
+        std::mt19937* m_rng;
+
+    public:
+        explicit Swaps(std::mt19937& rng) : m_rng{&rng} {}
+
+        void reset(std::size_t first) { m_drawn = first; }
+
+        // offset of the card that goes to position i, 0 .. 51 - i
+        int pick(std::size_t i)
+        {
+            while (m_drawn <= i)
+            {
+                m_pick[m_drawn] = std::uniform_int_distribution<int>{0, static_cast<int>(51 - m_drawn)}(*m_rng);
+                ++m_drawn;
+            }
+            return m_pick[i];
+        }
+    };
+
+    // A deck shuffled as it is dealt: position i is fixed by the i-th swap,
+    // so a hand only pays for the cards it uses. The deck starts sorted by
+    // value. The antithetic deck takes the opposite pick for the up card
+    // and the player's first card, so a low up card with a high first card
+    // becomes a high up card with a low first card. Those two cards decide
+    // most of the player's edge; mirroring the later cards as well made the
+    // pair positively correlated in tests
+    class LazyDeck
+    {
+        static constexpr std::size_t mirrored{2};   // positions 0 and 1
+
+        std::array<Card, 52> m_cards;
+        std::size_t m_next;
+        Swaps* m_swaps;
+        bool m_antithetic;
+
+    public:
+        // first is the number of cards placed before the shuffle (a fixed up card)
+        LazyDeck(const std::array<Card, 52>& base, std::size_t first, Swaps& swaps, bool antithetic)
+            : m_cards{base}, m_next{first}, m_swaps{&swaps}, m_antithetic{antithetic}
+        {}
+
+        Card draw()
+        {
+            std::size_t i{ m_next++ };
+            int pick{ m_swaps->pick(i) };
+            if (m_antithetic && i < mirrored)
+                pick = static_cast<int>(51 - i) - pick;
+            std::swap(m_cards[i], m_cards[i + static_cast<std::size_t>(pick)]);
+            return m_cards[i];
+        }
+    };
+
+    // Deals the up card, the player's two cards and then the dealer's
+    // draws before the player's, so the dealer's hand does not depend on
+    // the policy. Every card is equally likely anywhere in a shuffled deck,
+    // so the order of dealing does not change the odds
+    int playHand(Policy policy, const Card& up, LazyDeck& deck)
+    {
+        Player hand;
+        hand.takeCard(deck.draw());
+        hand.takeCard(deck.draw());
+
+        Player dealer;
+        dealer.takeCard(up);
+        while (dealer.score() < Rules::dealerLimit)
+            dealer.takeCard(deck.draw());
+
+        while (hand.score() < Rules::maxScore && policy(hand, up))
+            hand.takeCard(deck.draw());
+
+        if (hand.score() > Rules::maxScore)
+            return -1;
+        if (dealer.score() > Rules::maxScore || hand.score() > dealer.score())
+            return 1;
+        return hand.score() == dealer.score() ? 0 : -1;
+    }
+
+    // deck sorted by card value, with a card of the given rank at the front
+    std::array<Card, 52> orderedDeck(int upRank)
+    {
+        std::array<Card, 52> cards{};
+        std::size_t i{0};
+        for (auto rank : Card::allRanks)
+            for (auto suit : Card::allSuits)
+                cards[i++] = Card{rank, suit};
+        std::stable_sort(cards.begin(), cards.end(), [](const Card& a, const Card& b) { return a.value() < b.value(); });
+        if (upRank >= 0)
+        {
+            auto up{ std::find_if(cards.begin(), cards.end(), [&](const Card& c) { return c.rank == upRank; }) };
+            std::rotate(cards.begin(), up, up + 1);
+        }
+        return cards;
+    }
+
+    void playChunk(const CompareRun& run, long chunk, long samples, Tally& tally)
+    {
+        std::seed_seq seq{ run.seed, static_cast<std::uint32_t>(chunk) };
+        std::mt19937 rng{ seq };
+        const std::size_t policies{ run.policies.size() };
+        const std::size_t first{ run.stratified ? 1u : 0u };
+
+        std::array<std::array<Card, 52>, strata> base{};
+        for (int s = 0; s < strata; ++s)
+            base[s] = orderedDeck(run.stratified ? s : -1);
+
+        Swaps swaps{ rng };
+
+        // plays one deck; the up card is the first card dealt
+        auto play = [&](Policy policy, int stratum, bool antithetic) {
+            LazyDeck deck{ base[stratum], first, swaps, antithetic };
+            Card up{ run.stratified ? base[stratum][0] : deck.draw() };
+            return playHand(policy, up, deck);
+        };
+
+        std::vector<double> value(policies);
+        for (long i = 0; i < samples; ++i)
+        {
+            // stratum of the sample: every rank in turn
+            int stratum{ run.stratified ? static_cast<int>((chunk * chunkSamples + i) % strata) : 0 };
+            if (run.common)
+                swaps.reset(first);
+
+            for (std::size_t k = 0; k < policies; ++k)
+            {
+                if (!run.common)
+                    swaps.reset(first);
+                int x{ play(run.policies[k], stratum, false) };
+                tally.hand[k][stratum].add(x);
+                double y{ static_cast<double>(x) };
+                if (run.antithetic)
+                {
+                    int z{ play(run.policies[k], stratum, true) };
+                    tally.hand[k][stratum].add(z);
+                    y = (y + z) / 2.0;
+                }
+                value[k] = y;
+                tally.sample[k][stratum].add(y);
+                if (run.common)
+                    tally.diff[k][stratum].add(y - value[0]);
+            }
+        }
+    }
+
+    // stratified estimate from per-stratum moments; weight is 1 without strata
+    Estimate estimate(const std::array<Moments, strata>& sample, const std::array<Moments, strata>& hand, bool stratified)
+    {
+        Estimate e;
+        const int used{ stratified ? strata : 1 };
+        const double w{ 1.0 / used };
+        double meanSq{0};
+        for (int s = 0; s < used; ++s)
+        {
+            e.mean += w * sample[s].mean();
+            if (sample[s].n > 0)
+                e.variance += w * w * sample[s].variance() / sample[s].n;
+            meanSq += w * hand[s].meanSq();
+        }
+
+        // the variance of one hand from the mixture of the strata
+        double handMean{0};
+        for (int s = 0; s < used; ++s)
+            handMean += w * hand[s].mean();
+        e.handVariance = meanSq - handMean * handMean;
+        return e;
+    }
+
+    CompareResult compare(const CompareRun& run, Jobs::Runtime& runtime)
+    {
+        const std::size_t policies{ run.policies.size() };
+        const long samples{ run.antithetic ? (run.hands + 1) / 2 : run.hands };
+        const long chunks{ (samples + chunkSamples - 1) / chunkSamples };
+
+        auto begin{ std::chrono::steady_clock::now() };
+        Jobs::PerWorker<Tally> local{ runtime, Tally{policies} };
+
+        // the monitor follows the samples of the first policy over all up
+        // cards, so with strata its interval is wider than the estimate's
+        Convergence::Target target;
+        target.halfWidth = run.width;
+        target.reportSeconds = run.report;
+        target.samples = run.antithetic ? "pairs" : "hands";
+        Convergence::Monitor monitor{ runtime, target };
+
+        runtime.parallelFor(static_cast<std::size_t>(chunks), [&](std::size_t chunk, int worker) {
+            if (monitor.stopped())
+                return;
+            const long c{ static_cast<long>(chunk) };
+            Tally part{ policies };
+            playChunk(run, c, std::min(chunkSamples, samples - c * chunkSamples), part);
+            local[worker].merge(part);
+
+            Moments first;
+            for (const Moments& m : part.sample[0])
+                first.merge(m);
+            monitor.merge(worker, Convergence::Welford::fromSums(first.n, first.sum, first.sumSq));
+            monitor.publish(worker);
+        });
+        monitor.finish();
+        Tally tally{ policies };
+        local.forEach([&](const Tally& part) { tally.merge(part); });
+
+        CompareResult r;
+        r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        double played{0};
+        for (const Moments& m : tally.sample[0])
+            played += m.n;
+        r.hands = static_cast<long>(run.antithetic ? played * 2 : played);
+        for (std::size_t k = 0; k < policies; ++k)
+            r.policy.push_back(estimate(tally.sample[k], tally.hand[k], run.stratified));
+
+        for (std::size_t k = 0; k < policies; ++k)
+        {
+            Estimate d;
+            d.mean = r.policy[k].mean - r.policy[0].mean;
+            d.handVariance = r.policy[k].handVariance + r.policy[0].handVariance;
+            if (run.common)
+                d.variance = estimate(tally.diff[k], tally.hand[k], run.stratified).variance;
+            else
+                d.variance = r.policy[k].variance + r.policy[0].variance;
+            r.diff.push_back(d);
+        }
+        return r;
+    }
+
+    CompareResult compare(const CompareRun& run)
+    {
+        const long chunks{ ((run.antithetic ? (run.hands + 1) / 2 : run.hands) + chunkSamples - 1) / chunkSamples };
+        Jobs::Runtime runtime{ static_cast<int>(std::max(1L, std::min<long>(run.threads, chunks))) };
+        return compare(run, runtime);
+    }
+
+    std::string modeName(const CompareRun& run)
+    {
+        std::string name;
+        if (run.common) name += "common numbers, ";
+        if (run.antithetic) name += "antithetic, ";
+        if (run.stratified) name += "stratified, ";
+        return name.empty() ? "plain" : name.substr(0, name.size() - 2);
+    }
+
+    void print(const CompareRun& run, const CompareResult& r)
+    {
+        auto row = [&](const std::string& name, const Estimate& e) {
+            std::cout << std::left << std::setw(10) << name << std::right << std::setprecision(5)
+                      << std::setw(11) << e.mean << std::setw(12) << e.halfWidth() << std::setprecision(0)
+                      << std::setw(14) << e.effectiveHands() << std::setprecision(2)
+                      << std::setw(10) << e.effectiveHands() / static_cast<double>(r.hands)
+                      << std::setw(12) << e.effectiveHands() / r.seconds / 1e6 << '\n';
+        };
+
+        std::cout << std::fixed << modeName(run) << ": " << r.hands << " hands per policy, " << std::setprecision(2)
+                  << r.seconds << " s\n\n";
+        std::cout << "policy     net/hand   95% CI +-    eff. hands      gain   eff. M/s\n";
+        for (std::size_t k = 0; k < r.policy.size(); ++k)
+            row(run.names[k], r.policy[k]);
+        if (r.policy.size() > 1)
+        {
+            std::cout << "\ndifference from " << run.names[0] << '\n';
+            for (std::size_t k = 1; k < r.diff.size(); ++k)
+                row(run.names[k], r.diff[k]);
+        }
+    }
+}
+
+// BlackJack --compare basic,dealer [--hands N] [--threads N] [--seed S]
+//           [--common] [--antithetic] [--stratified] [--all-modes]
+//           [--width W] [--report S]
+// With --width, --hands is the most hands to play
+int compareMain(int argc, char* argv[])
+{
+    Variance::CompareRun run;
+    std::string list{"basic,dealer"};
+    bool allModes{false};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg{ argv[i] };
+        if (arg == "--common") { run.common = true; continue; }
+        if (arg == "--antithetic") { run.antithetic = true; continue; }
+        if (arg == "--stratified") { run.stratified = true; continue; }
+        if (arg == "--all-modes") { allModes = true; continue; }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << '\n';
+            return 1;
+        }
+        std::string value{ argv[++i] };
+        if (arg == "--compare") list = value;
+        else if (arg == "--hands") run.hands = std::stol(value);
+        else if (arg == "--threads") run.threads = std::stoi(value);
+        else if (arg == "--seed") run.seed = static_cast<std::uint32_t>(std::stoul(value));
+        else if (arg == "--width") run.width = std::stod(value);
+        else if (arg == "--report") run.report = std::stod(value);
+        else
+        {
+            std::cerr << "Unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+    if (!parsePolicies(list, run.policies, run.names))
+        return 1;
+    if (run.hands < 2)
+    {
+        std::cerr << "Need at least two hands\n";
+        return 1;
+    }
+    // the antithetic pair mirrors the up card, which stratification fixes;
+    // what is left to mirror makes the pair positively correlated
+    if (run.antithetic && run.stratified)
+    {
+        std::cerr << "--antithetic and --stratified cannot be combined\n";
+        return 1;
+    }
+
+    if (!allModes)
+    {
+        Variance::print(run, Variance::compare(run));
+        return 0;
+    }
+
+    // the same budget in every mode; antithetic and stratified are not combined
+    const bool modes[][3]{
+        {false, false, false}, {true, false, false}, {false, true, false}, {false, false, true},
+        {true, true, false}, {true, false, true}
+    };
+    std::cout << "mode                                 " << std::left << std::setw(9) << run.names[0] << std::right
+              << "CI +-    eff. M/s";
+    if (run.policies.size() > 1)
+        std::cout << "   diff CI +-    eff. M/s";
+    std::cout << "\n" << std::fixed;
+    for (const auto& m : modes)
+    {
+        run.common = m[0];
+        run.antithetic = m[1];
+        run.stratified = m[2];
+        Variance::CompareResult r{ Variance::compare(run) };
+        std::cout << std::left << std::setw(38) << Variance::modeName(run) << std::right << std::setprecision(5)
+                  << std::setw(12) << r.policy[0].halfWidth() << std::setprecision(2)
+                  << std::setw(12) << r.policy[0].effectiveHands() / r.seconds / 1e6;
+        if (run.policies.size() > 1)
+            std::cout << std::setprecision(5) << std::setw(13) << r.diff[1].halfWidth() << std::setprecision(2)
+                      << std::setw(12) << r.diff[1].effectiveHands() / r.seconds / 1e6;
+        std::cout << '\n';
+    }
+    return 0;
+}
+
+// BlackJack --scaling [max threads] [--hands N]
+// Plays the same heads-up hands of the basic policy on 1, 2, 4 ... workers
+int scalingMain(int argc, char* argv[])
+{
+    int maxThreads{64};
+    Variance::CompareRun run;
+    run.hands = 4000000;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string_view arg{ argv[i] };
+        if (arg == "--hands" && i + 1 < argc)
+            run.hands = std::stol(argv[++i]);
+        else if (!arg.empty() && arg[0] != '-')
+            maxThreads = std::max(1, std::stoi(std::string{arg}));
+        else
+        {
+            std::cerr << "Unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+    if (!parsePolicies("basic", run.policies, run.names))
+        return 1;
+
+    Jobs::scaling(maxThreads, static_cast<double>(run.hands), "hands", [&](Jobs::Runtime& runtime) {
+        return Variance::compare(run, runtime).policy[0].mean;
+    });
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    // BlackJack --trace <file> plays interactively and writes a latency trace
+    std::unique_ptr<Trace::Session> trace;
+    if (argc == 3 && std::string_view{argv[1]} == "--trace")
+    {
+        trace = std::make_unique<Trace::Session>(argv[2]);
+        argc = 1;
+    }
+
+    // any other option runs a simulation instead of the interactive game
+    if (argc > 1 && std::string_view{argv[1]} == "--compare")
+        return compareMain(argc, argv);
+    if (argc > 1 && std::string_view{argv[1]} == "--scaling")
+        return scalingMain(argc, argv);
+    if (argc > 1)
+        return simulationMain(argc, argv);
+
     switch (playGame())
     {
     case Result::PlayerWin: std::cout << "You win!\n"; break;
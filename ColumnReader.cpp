@@ -0,0 +1,249 @@
+// Aggregates over a columnar results store written by the simulations.
+//
+// Build: g++ -std=c++17 -O3 -march=native -pthread ColumnReader.cpp -o ColumnReader
+// Usage: ColumnReader <store path> [--by <u8 column>] [--threads N]
+//
+// Every segment <path>.<n>.col is mapped read-only and scanned block by
+// block, one column at a time, by the scans in ColumnStore.h. Prints the
+// row count, min, max and mean of every column and, with --by, the row
+// count and the means of the other columns for every value of a key
+// column (e.g. the result of a hand or the seat).
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ColumnStore.h"
+#include "JobRuntime.h"
+
+struct ColumnTotal
+{
+    std::int64_t sum{0};
+    std::int64_t min{ std::numeric_limits<std::int64_t>::max() };
+    std::int64_t max{ std::numeric_limits<std::int64_t>::min() };
+
+    void merge(const ColumnTotal& o)
+    {
+        sum += o.sum;
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+    }
+};
+
+struct Totals
+{
+    std::uint64_t rows{0};
+    std::vector<ColumnTotal> columns{};
+    std::array<std::uint64_t, 256> groupRows{};
+    std::vector<std::array<std::int64_t, 256>> groupSums{};   // [column][key value]
+
+    explicit Totals(std::size_t n) : columns(n), groupSums(n) {}
+
+    void merge(const Totals& o)
+    {
+        rows += o.rows;
+        for (std::size_t c = 0; c < columns.size(); ++c)
+        {
+            columns[c].merge(o.columns[c]);
+            for (std::size_t k = 0; k < 256; ++k)
+                groupSums[c][k] += o.groupSums[c][k];
+        }
+        for (std::size_t k = 0; k < 256; ++k)
+            groupRows[k] += o.groupRows[k];
+    }
+};
+
+// calls f with the column of a block as a typed pointer
+template <typename F>
+void visit(Columns::Type type, const void* p, F&& f)
+{
+    using Columns::Type;
+    switch (type)
+    {
+    case Type::u8: f(static_cast<const std::uint8_t*>(p)); break;
+    case Type::u16: f(static_cast<const std::uint16_t*>(p)); break;
+    case Type::u32: f(static_cast<const std::uint32_t*>(p)); break;
+    case Type::i16: f(static_cast<const std::int16_t*>(p)); break;
+    case Type::i32: f(static_cast<const std::int32_t*>(p)); break;
+    default: break;
+    }
+}
+
+// adds block b of a segment to the totals
+void scan(const Columns::Segment& seg, std::size_t b, int by, Totals& t)
+{
+    const Columns::Header& h{ seg.header() };
+    const std::size_t n{ seg.rowsIn(b) };
+    t.rows += n;
+
+    for (std::uint32_t c = 0; c < h.columns; ++c)
+    {
+        ColumnTotal& total{ t.columns[c] };
+        visit(h.column[c].type, seg.column(static_cast<int>(c), b), [&](auto v) {
+            auto [lo, hi] = Columns::minMax(v, n);
+            total.sum += Columns::sum(v, n);
+            total.min = std::min<std::int64_t>(total.min, static_cast<std::int64_t>(lo));
+            total.max = std::max<std::int64_t>(total.max, static_cast<std::int64_t>(hi));
+        });
+    }
+
+    if (by < 0)
+        return;
+
+    // one pass per column into the slots of all key values
+    const auto* key{ static_cast<const std::uint8_t*>(seg.column(by, b)) };
+    Columns::countBy(key, n, t.groupRows.data());
+    for (std::uint32_t c = 0; c < h.columns; ++c)
+    {
+        if (static_cast<int>(c) == by)
+            continue;
+        visit(h.column[c].type, seg.column(static_cast<int>(c), b), [&](auto v) {
+            Columns::sumBy(v, key, n, t.groupSums[c].data());
+        });
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <store path> [--by <u8 column>] [--threads N]\n";
+        return 1;
+    }
+
+    const std::string path{ argv[1] };
+    std::string byName;
+    int threads{ static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };
+    for (int i = 2; i < argc; i += 2)
+    {
+        std::string_view arg{ argv[i] };
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << '\n';
+            return 1;
+        }
+        if (arg == "--by") byName = argv[i + 1];
+        else if (arg == "--threads") threads = std::max(1, std::stoi(argv[i + 1]));
+        else
+        {
+            std::cerr << "Unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<Columns::Segment>> segments;
+    while (true)
+    {
+        std::string file{ Columns::segmentPath(path, static_cast<int>(segments.size())) };
+        if (access(file.c_str(), F_OK) != 0)
+            break;
+        segments.push_back(std::make_unique<Columns::Segment>(file));
+        if (!segments.back()->ok())
+        {
+            std::cerr << file << ": not a column segment\n";
+            return 1;
+        }
+    }
+    if (segments.empty())
+    {
+        std::cerr << "No segments " << Columns::segmentPath(path, 0) << '\n';
+        return 1;
+    }
+
+    // all segments of a store share the schema of the first one
+    const Columns::Header& schema{ segments[0]->header() };
+    for (const auto& s : segments)
+    {
+        const Columns::Header& h{ s->header() };
+        if (h.columns != schema.columns
+            || !std::equal(h.column, h.column + h.columns, schema.column, [](const auto& a, const auto& b) {
+                   return a.type == b.type && std::string_view{a.name} == b.name;
+               }))
+        {
+            std::cerr << "Segments have different columns\n";
+            return 1;
+        }
+    }
+
+    int by{-1};
+    if (!byName.empty())
+    {
+        by = segments[0]->find(byName);
+        if (by < 0 || schema.column[by].type != Columns::Type::u8)
+        {
+            std::cerr << "No u8 column " << byName << '\n';
+            return 1;
+        }
+    }
+
+    // every block of every segment is a job block, scanned into the totals
+    // of the worker that runs it
+    std::vector<std::pair<std::size_t, std::size_t>> blocks;   // (segment, block)
+    for (std::size_t s = 0; s < segments.size(); ++s)
+        for (std::size_t b = 0; b < segments[s]->blocks(); ++b)
+            blocks.emplace_back(s, b);
+
+    auto begin{ std::chrono::steady_clock::now() };
+    threads = std::max(1, std::min<int>(threads, static_cast<int>(blocks.size())));
+    Jobs::Runtime runtime{ threads };
+    Jobs::PerWorker<Totals> local{ runtime, Totals{schema.columns} };
+    runtime.parallelFor(blocks.size(), [&](std::size_t i, int worker) {
+        scan(*segments[blocks[i].first], blocks[i].second, by, local[worker]);
+    });
+    Totals total{ schema.columns };
+    local.forEach([&](const Totals& part) { total.merge(part); });
+    std::chrono::duration<double> took{ std::chrono::steady_clock::now() - begin };
+
+    std::size_t rowBytes{0};
+    for (std::uint32_t c = 0; c < schema.columns; ++c)
+        rowBytes += Columns::width(schema.column[c].type);
+
+    std::cout << segments.size() << " segments, " << total.rows << " rows, seed " << schema.seed << "\n\n";
+    std::cout << "column                 min             max            mean\n";
+    std::cout << std::fixed;
+    for (std::uint32_t c = 0; c < schema.columns; ++c)
+    {
+        const ColumnTotal& ct{ total.columns[c] };
+        double mean{ total.rows ? static_cast<double>(ct.sum) / static_cast<double>(total.rows) : 0.0 };
+        std::cout << std::left << std::setw(12) << schema.column[c].name << std::right
+                  << std::setw(12) << (total.rows ? ct.min : 0) << std::setw(16) << (total.rows ? ct.max : 0)
+                  << std::setprecision(4) << std::setw(16) << mean << '\n';
+    }
+
+    if (by >= 0)
+    {
+        std::cout << '\n' << std::left << std::setw(8) << schema.column[by].name << std::right << std::setw(14) << "rows"
+                  << std::setw(9) << "share";
+        for (std::uint32_t c = 0; c < schema.columns; ++c)
+            if (static_cast<int>(c) != by)
+                std::cout << std::setw(16) << schema.column[c].name;
+        std::cout << '\n';
+
+        for (std::size_t k = 0; k < 256; ++k)
+        {
+            std::uint64_t n{ total.groupRows[k] };
+            if (n == 0)
+                continue;
+            std::cout << std::left << std::setw(8) << k << std::right << std::setw(14) << n << std::setprecision(2)
+                      << std::setw(8) << 100.0 * static_cast<double>(n) / static_cast<double>(total.rows) << '%';
+            for (std::uint32_t c = 0; c < schema.columns; ++c)
+                if (static_cast<int>(c) != by)
+                    std::cout << std::setprecision(4) << std::setw(16)
+                              << static_cast<double>(total.groupSums[c][k]) / static_cast<double>(n);
+            std::cout << '\n';
+        }
+    }
+
+    double gb{ static_cast<double>(total.rows * rowBytes) / 1e9 };
+    std::cout << std::setprecision(3) << "\nscanned " << gb << " GB in " << took.count() << " s on " << threads
+              << " threads, " << static_cast<double>(total.rows) / took.count() / 1e9 << " G rows/s\n";
+    return 0;
+}
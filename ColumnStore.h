@@ -0,0 +1,370 @@
+// Append-only columnar store for simulation results.
+//
+// A store is a set of segment files <path>.<n>.col, one per writer thread,
+// so threads append without locking. A segment starts with a one-page
+// header (schema and row count) followed by blocks of blockRows rows. In a
+// block every column is a contiguous array of fixed-width values, so a
+// column of one block is a plain array that scans can vectorise. The file
+// grows one block at a time and only the current block is mapped while
+// writing; the reader maps the whole segment. Values are in host byte order.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Columns
+{
+    constexpr std::size_t maxColumns{ 16 };
+    constexpr std::size_t blockRows{ 1 << 16 };
+    constexpr std::size_t headerBytes{ 4096 };
+
+    constexpr char magic[4]{ 'C', 'O', 'L', '1' };
+    constexpr std::uint32_t version{ 2 };
+
+    // every value fits the int64_t sums, minima and maxima of the scans
+    enum class Type : std::uint8_t
+    {
+        u8, u16, u32, i16, i32,
+        max_types
+    };
+
+    constexpr std::size_t width(Type t)
+    {
+        constexpr std::size_t widths[]{ 1, 2, 4, 2, 4 };
+        return widths[static_cast<int>(t)];
+    }
+
+    template <typename T> constexpr Type typeOf();
+    template <> constexpr Type typeOf<std::uint8_t>() { return Type::u8; }
+    template <> constexpr Type typeOf<std::uint16_t>() { return Type::u16; }
+    template <> constexpr Type typeOf<std::uint32_t>() { return Type::u32; }
+    template <> constexpr Type typeOf<std::int16_t>() { return Type::i16; }
+    template <> constexpr Type typeOf<std::int32_t>() { return Type::i32; }
+
+    struct Column
+    {
+        char name[15];
+        Type type;
+    };
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t columns;
+        std::uint32_t blockRows;
+        std::uint64_t rows;
+        std::uint64_t seed;      // seed the rows' generators were derived from
+        Column column[maxColumns];
+    };
+    static_assert(sizeof(Header) <= headerBytes, "the header fits in its page");
+
+    struct Schema
+    {
+        std::vector<Column> columns{};
+
+        // adds a column and returns its index
+        int add(std::string_view name, Type type)
+        {
+            assert(columns.size() < maxColumns && name.size() < sizeof(Column::name));
+            Column c{};
+            std::memcpy(c.name, name.data(), std::min(name.size(), sizeof c.name - 1));
+            c.type = type;
+            columns.push_back(c);
+            return static_cast<int>(columns.size()) - 1;
+        }
+
+        // offsets of the columns in a block, each column 64-byte aligned
+        std::array<std::size_t, maxColumns + 1> offsets(std::size_t rows) const
+        {
+            std::array<std::size_t, maxColumns + 1> at{};
+            for (std::size_t c = 0; c < columns.size(); ++c)
+                at[c + 1] = at[c] + (rows * width(columns[c].type) + 63) / 64 * 64;
+            return at;
+        }
+    };
+
+    inline std::string segmentPath(const std::string& path, int n)
+    {
+        return path + "." + std::to_string(n) + ".col";
+    }
+
+    // removes the segments of an earlier store at the same path
+    inline void clear(const std::string& path)
+    {
+        for (int n = 0; unlink(segmentPath(path, n).c_str()) == 0; ++n)
+        {
+        }
+    }
+
+    // One thread's segment. append() starts a new row in the current block
+    // and set() fills in its values
+    class Writer
+    {
+        int m_fd{-1};
+        Header m_header{};
+        std::array<std::size_t, maxColumns + 1> m_offset{};
+        std::size_t m_blockBytes{0};
+        std::uint64_t m_blocks{0};
+        unsigned char* m_block{nullptr};
+        std::size_t m_used{blockRows};   // rows used in the mapped block
+        std::size_t m_row{0};
+
+        void unmapBlock()
+        {
+            if (m_block)
+                munmap(m_block, m_blockBytes);
+            m_block = nullptr;
+        }
+
+        bool nextBlock()
+        {
+            unmapBlock();
+            off_t at{ static_cast<off_t>(headerBytes + m_blocks * m_blockBytes) };
+            if (ftruncate(m_fd, at + static_cast<off_t>(m_blockBytes)) != 0)
+                return false;
+            void* p{ mmap(nullptr, m_blockBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, at) };
+            if (p == MAP_FAILED)
+                return false;
+            m_block = static_cast<unsigned char*>(p);
+            ++m_blocks;
+            m_used = 0;
+            return true;
+        }
+
+    public:
+        Writer(const std::string& file, const Schema& schema, std::uint64_t seed)
+        {
+            std::memcpy(m_header.magic, magic, sizeof magic);
+            m_header.version = version;
+            m_header.columns = static_cast<std::uint32_t>(schema.columns.size());
+            m_header.blockRows = blockRows;
+            m_header.seed = seed;
+            std::copy(schema.columns.begin(), schema.columns.end(), m_header.column);
+            m_offset = schema.offsets(blockRows);
+            m_blockBytes = m_offset[schema.columns.size()];
+
+            m_fd = open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (m_fd >= 0 && ftruncate(m_fd, headerBytes) != 0)
+            {
+                ::close(m_fd);
+                m_fd = -1;
+            }
+        }
+
+        ~Writer() { close(); }
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        bool ok() const { return m_fd >= 0; }
+        std::uint64_t rows() const { return m_header.rows; }
+
+        // false if the file could not grow
+        bool append()
+        {
+            if (m_used == blockRows && !nextBlock())
+                return false;
+            m_row = m_used++;
+            ++m_header.rows;
+            return true;
+        }
+
+        template <typename T>
+        void set(int column, T value)
+        {
+            assert(m_header.column[column].type == typeOf<T>());
+            reinterpret_cast<T*>(m_block + m_offset[column])[m_row] = value;
+        }
+
+        // writes the header; the segment is readable afterwards
+        bool close()
+        {
+            if (m_fd < 0)
+                return false;
+            unmapBlock();
+            bool ok{ pwrite(m_fd, &m_header, sizeof m_header, 0) == static_cast<ssize_t>(sizeof m_header) };
+            ok = ::close(m_fd) == 0 && ok;
+            m_fd = -1;
+            return ok;
+        }
+    };
+
+    // A segment mapped read-only as a whole
+    class Segment
+    {
+        const unsigned char* m_data{nullptr};
+        std::size_t m_size{0};
+        const Header* m_header{nullptr};
+        std::array<std::size_t, maxColumns + 1> m_offset{};
+        std::size_t m_blockBytes{0};
+
+    public:
+        explicit Segment(const std::string& file)
+        {
+            int fd{ open(file.c_str(), O_RDONLY) };
+            if (fd < 0)
+                return;
+            struct stat st{};
+            if (fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= headerBytes)
+            {
+                void* p{ mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0) };
+                if (p != MAP_FAILED)
+                {
+                    m_data = static_cast<const unsigned char*>(p);
+                    m_size = static_cast<std::size_t>(st.st_size);
+                    madvise(p, m_size, MADV_SEQUENTIAL);
+                }
+            }
+            ::close(fd);
+            if (!m_data)
+                return;
+
+            m_header = reinterpret_cast<const Header*>(m_data);
+            bool valid{ std::memcmp(m_header->magic, magic, sizeof magic) == 0 && m_header->version == version
+                        && m_header->columns <= maxColumns && m_header->blockRows > 0 };
+            for (std::uint32_t c = 0; valid && c < m_header->columns; ++c)
+                valid = m_header->column[c].type < Type::max_types;
+
+            // the layout is only computed from a header known to be valid
+            if (valid)
+            {
+                Schema schema{ std::vector<Column>(m_header->column, m_header->column + m_header->columns) };
+                m_offset = schema.offsets(m_header->blockRows);
+                m_blockBytes = m_offset[schema.columns.size()];
+                valid = headerBytes + blocks() * m_blockBytes <= m_size;
+            }
+            if (!valid)
+            {
+                munmap(const_cast<unsigned char*>(m_data), m_size);
+                m_data = nullptr;
+                m_header = nullptr;
+            }
+        }
+
+        ~Segment()
+        {
+            if (m_data)
+                munmap(const_cast<unsigned char*>(m_data), m_size);
+        }
+
+        Segment(const Segment&) = delete;
+        Segment& operator=(const Segment&) = delete;
+
+        bool ok() const { return m_header != nullptr; }
+        const Header& header() const { return *m_header; }
+        std::uint64_t rows() const { return m_header->rows; }
+
+        std::size_t blocks() const
+        {
+            return static_cast<std::size_t>((m_header->rows + m_header->blockRows - 1) / m_header->blockRows);
+        }
+
+        std::size_t rowsIn(std::size_t block) const
+        {
+            std::uint64_t first{ static_cast<std::uint64_t>(block) * m_header->blockRows };
+            return static_cast<std::size_t>(std::min<std::uint64_t>(m_header->blockRows, m_header->rows - first));
+        }
+
+        // index of the named column, or -1
+        int find(std::string_view name) const
+        {
+            for (std::uint32_t c = 0; c < m_header->columns; ++c)
+                if (name == m_header->column[c].name)
+                    return static_cast<int>(c);
+            return -1;
+        }
+
+        const void* column(int c, std::size_t block) const
+        {
+            return m_data + headerBytes + block * m_blockBytes + m_offset[static_cast<std::size_t>(c)];
+        }
+    };
+
+    // Scans over one column of a block. Plain loops over contiguous arrays
+    // with no branches in the body, which the compiler turns into SIMD code.
+    // Narrow unsigned values are added in 32 bits over runs of blockRows
+    // (they cannot overflow there), which keeps more lanes in a vector
+
+    template <typename T>
+    using Accumulator = std::conditional_t<std::is_unsigned_v<T> && sizeof(T) <= 2, std::uint32_t, std::int64_t>;
+
+    template <typename T>
+    std::int64_t sum(const T* v, std::size_t n)
+    {
+        std::int64_t s{0};
+        for (std::size_t at = 0; at < n; at += blockRows)
+        {
+            Accumulator<T> part{0};
+            for (std::size_t i = at; i < std::min(n, at + blockRows); ++i)
+                part += v[i];
+            s += static_cast<std::int64_t>(part);
+        }
+        return s;
+    }
+
+    // Grouped scans: one pass adds every row to the slot of its key value.
+    // Consecutive rows go to four partial tables in turn, so rows with the
+    // same key do not wait for each other's stores
+
+    // sums[k] += sum of v where key == k
+    template <typename T>
+    void sumBy(const T* v, const std::uint8_t* key, std::size_t n, std::int64_t* sums)
+    {
+        std::int64_t part[4][256]{};
+        std::size_t i{0};
+        for (; i + 4 <= n; i += 4)
+        {
+            part[0][key[i]] += v[i];
+            part[1][key[i + 1]] += v[i + 1];
+            part[2][key[i + 2]] += v[i + 2];
+            part[3][key[i + 3]] += v[i + 3];
+        }
+        for (; i < n; ++i)
+            part[0][key[i]] += v[i];
+        for (std::size_t k = 0; k < 256; ++k)
+            sums[k] += part[0][k] + part[1][k] + part[2][k] + part[3][k];
+    }
+
+    // counts[k] += rows where key == k
+    inline void countBy(const std::uint8_t* key, std::size_t n, std::uint64_t* counts)
+    {
+        std::uint64_t part[4][256]{};
+        std::size_t i{0};
+        for (; i + 4 <= n; i += 4)
+        {
+            ++part[0][key[i]];
+            ++part[1][key[i + 1]];
+            ++part[2][key[i + 2]];
+            ++part[3][key[i + 3]];
+        }
+        for (; i < n; ++i)
+            ++part[0][key[i]];
+        for (std::size_t k = 0; k < 256; ++k)
+            counts[k] += part[0][k] + part[1][k] + part[2][k] + part[3][k];
+    }
+
+    template <typename T>
+    std::pair<T, T> minMax(const T* v, std::size_t n)
+    {
+        T lo{ v[0] }, hi{ v[0] };
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const T x{ v[i] };
+            lo = x < lo ? x : lo;
+            hi = x > hi ? x : hi;
+        }
+        return { lo, hi };
+    }
+}
@@ -0,0 +1,296 @@
+// Online statistics of a running simulation, with early stopping.
+//
+// Every worker of a job keeps a running mean and variance (Welford) of the
+// per-sample value it plays, e.g. 1 for a won game and 0 for a lost one,
+// and optionally a histogram of an integer value per sample (gold, hands
+// played) for quantiles. After every block the worker publishes a copy of
+// its state through a sequence lock: it never waits, and the reporter
+// thread retries a read that overlapped a publication. The reporter merges
+// the copies every few milliseconds, prints a line at every report
+// interval, and raises the stop flag once the 95% confidence interval of
+// the mean is narrower than the target. Workers check the flag at the start
+// of a block and skip the remaining blocks.
+//
+// A stopped run has played a number of blocks that depends on timing, so
+// its estimate is no longer the same for every number of workers; the
+// final snapshot states how many samples it is based on.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "JobRuntime.h"
+
+namespace Convergence
+{
+    // Running mean and sum of squared deviations. Two of them merge
+    // exactly, so the workers' states add up to the state of the whole run
+    struct Welford
+    {
+        std::uint64_t n{0};
+        double mean{0};
+        double m2{0};
+
+        void add(double x)
+        {
+            ++n;
+            double d{ x - mean };
+            mean += d / static_cast<double>(n);
+            m2 += d * (x - mean);
+        }
+
+        void merge(const Welford& o)
+        {
+            if (o.n == 0)
+                return;
+            if (n == 0)
+            {
+                *this = o;
+                return;
+            }
+            const double a{ static_cast<double>(n) };
+            const double b{ static_cast<double>(o.n) };
+            const double d{ o.mean - mean };
+            mean += d * b / (a + b);
+            m2 += o.m2 + d * d * a * b / (a + b);
+            n += o.n;
+        }
+
+        // from a count, sum and sum of squares
+        static Welford fromSums(double count, double sum, double sumSq)
+        {
+            Welford w;
+            if (count <= 0)
+                return w;
+            w.n = static_cast<std::uint64_t>(count);
+            w.mean = sum / count;
+            w.m2 = std::max(0.0, sumSq - sum * sum / count);
+            return w;
+        }
+
+        double variance() const { return n > 1 ? m2 / static_cast<double>(n - 1) : 0.0; }
+
+        // of the 95% confidence interval of the mean
+        double halfWidth() const
+        {
+            return n > 1 ? 1.96 * std::sqrt(variance() / static_cast<double>(n)) : std::numeric_limits<double>::infinity();
+        }
+    };
+
+    // Counts of the values 0 .. bins - 1; larger values go to the last bin
+    struct Histogram
+    {
+        std::vector<std::uint64_t> counts{};
+
+        void add(std::int64_t v)
+        {
+            std::size_t bin{ static_cast<std::size_t>(std::clamp<std::int64_t>(v, 0, static_cast<std::int64_t>(counts.size()) - 1)) };
+            ++counts[bin];
+        }
+
+        // smallest value with at least a share q of the samples at or below it
+        std::int64_t quantile(double q) const
+        {
+            std::uint64_t total{0};
+            for (auto c : counts)
+                total += c;
+            const double target{ q * static_cast<double>(total) };
+            std::uint64_t below{0};
+            for (std::size_t v = 0; v < counts.size(); ++v)
+            {
+                below += counts[v];
+                if (below > 0 && static_cast<double>(below) >= target)
+                    return static_cast<std::int64_t>(v);
+            }
+            return 0;
+        }
+    };
+
+    struct Target
+    {
+        double halfWidth{0};             // stop at this 95% CI half-width of the mean, 0 to play every block
+        std::uint64_t minSamples{1000};  // never stop before this many samples
+        double reportSeconds{0};         // interval of the live reports, 0 for none
+        std::size_t bins{0};             // histogram size, 0 for no quantiles
+        std::string samples{"samples"};  // names for the report
+        std::string value{"value"};
+    };
+
+    struct Snapshot
+    {
+        Welford stat{};
+        Histogram histogram{};
+        double seconds{0};
+    };
+
+    class Monitor
+    {
+        // a worker's running state and its published copy, on separate cache lines
+        struct Slot
+        {
+            Welford local{};
+            Histogram localBins{};
+
+            alignas(64) std::atomic<std::uint64_t> seq{0};   // odd while the worker writes
+            std::atomic<std::uint64_t> n{0};
+            std::atomic<double> mean{0};
+            std::atomic<double> m2{0};
+            std::unique_ptr<std::atomic<std::uint64_t>[]> bins{};
+        };
+
+        Target m_target;
+        std::vector<std::unique_ptr<Slot>> m_slots;
+        std::chrono::steady_clock::time_point m_begin{ std::chrono::steady_clock::now() };
+        std::atomic<bool> m_stop{false};
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        bool m_finished{false};
+        std::thread m_reporter;
+
+        // reads one worker's published state, retrying while it changes
+        void read(const Slot& s, Snapshot& out) const
+        {
+            Welford w;
+            std::vector<std::uint64_t> bins(m_target.bins);
+            while (true)
+            {
+                std::uint64_t before{ s.seq.load(std::memory_order_acquire) };
+                if (before & 1)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                w.n = s.n.load(std::memory_order_relaxed);
+                w.mean = s.mean.load(std::memory_order_relaxed);
+                w.m2 = s.m2.load(std::memory_order_relaxed);
+                for (std::size_t b = 0; b < bins.size(); ++b)
+                    bins[b] = s.bins[b].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.seq.load(std::memory_order_relaxed) == before)
+                    break;
+            }
+            out.stat.merge(w);
+            for (std::size_t b = 0; b < bins.size(); ++b)
+                out.histogram.counts[b] += bins[b];
+        }
+
+        void print(const Snapshot& s) const
+        {
+            std::cout << std::fixed << std::setprecision(2) << std::setw(8) << s.seconds << " s" << std::setw(12) << s.stat.n
+                      << ' ' << m_target.samples << std::setprecision(6) << "  mean " << s.stat.mean << " +- "
+                      << s.stat.halfWidth();
+            if (m_target.bins > 0 && s.stat.n > 0)
+                std::cout << "  " << m_target.value << " p10 " << s.histogram.quantile(0.1) << " p50 "
+                          << s.histogram.quantile(0.5) << " p90 " << s.histogram.quantile(0.9);
+            std::cout << std::endl;
+        }
+
+        void report()
+        {
+            constexpr auto poll{ std::chrono::milliseconds{10} };
+            double nextReport{ m_target.reportSeconds };
+            std::unique_lock lock{ m_mutex };
+            while (!m_wake.wait_for(lock, poll, [&] { return m_finished; }))
+            {
+                Snapshot s{ snapshot() };
+                if (m_target.halfWidth > 0 && s.stat.n >= m_target.minSamples && s.stat.halfWidth() <= m_target.halfWidth)
+                    m_stop.store(true, std::memory_order_relaxed);
+                if (m_target.reportSeconds > 0 && s.seconds >= nextReport)
+                {
+                    print(s);
+                    nextReport += m_target.reportSeconds;
+                }
+            }
+        }
+
+    public:
+        Monitor(const Jobs::Runtime& runtime, Target target) : m_target{ std::move(target) }
+        {
+            for (int w = 0; w < runtime.workers(); ++w)
+            {
+                auto s{ std::make_unique<Slot>() };
+                s->localBins.counts.assign(m_target.bins, 0);
+                s->bins = std::make_unique<std::atomic<std::uint64_t>[]>(m_target.bins);
+                m_slots.push_back(std::move(s));
+            }
+            if (m_target.halfWidth > 0 || m_target.reportSeconds > 0)
+                m_reporter = std::thread{ [this] { report(); } };
+        }
+
+        ~Monitor() { finish(); }
+
+        Monitor(const Monitor&) = delete;
+        Monitor& operator=(const Monitor&) = delete;
+
+        // one sample of a worker, with the integer value for the histogram
+        void add(int worker, double x, std::int64_t value = 0)
+        {
+            Slot& s{ *m_slots[static_cast<std::size_t>(worker)] };
+            s.local.add(x);
+            if (m_target.bins > 0)
+                s.localBins.add(value);
+        }
+
+        // samples a worker has summed up itself
+        void merge(int worker, const Welford& w)
+        {
+            m_slots[static_cast<std::size_t>(worker)]->local.merge(w);
+        }
+
+        // makes a worker's samples so far visible to the reporter
+        void publish(int worker)
+        {
+            Slot& s{ *m_slots[static_cast<std::size_t>(worker)] };
+            const std::uint64_t seq{ s.seq.load(std::memory_order_relaxed) };
+            s.seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            s.n.store(s.local.n, std::memory_order_relaxed);
+            s.mean.store(s.local.mean, std::memory_order_relaxed);
+            s.m2.store(s.local.m2, std::memory_order_relaxed);
+            for (std::size_t b = 0; b < m_target.bins; ++b)
+                s.bins[b].store(s.localBins.counts[b], std::memory_order_relaxed);
+            s.seq.store(seq + 2, std::memory_order_release);
+        }
+
+        // true once the target is reached; the remaining blocks can be skipped
+        bool stopped() const { return m_stop.load(std::memory_order_relaxed); }
+
+        // the published state of all workers
+        Snapshot snapshot() const
+        {
+            Snapshot s;
+            s.histogram.counts.assign(m_target.bins, 0);
+            for (const auto& slot : m_slots)
+                read(*slot, s);
+            s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_begin).count();
+            return s;
+        }
+
+        // stops the reporter; call after the job, when every worker has published
+        Snapshot finish()
+        {
+            {
+                std::lock_guard lock{ m_mutex };
+                m_finished = true;
+            }
+            m_wake.notify_all();
+            if (m_reporter.joinable())
+                m_reporter.join();
+            return snapshot();
+        }
+    };
+}
@@ -0,0 +1,335 @@
+// Work-stealing job runtime shared by the simulations.
+//
+// A job is a loop over blocks 0 .. n - 1 (a block is a batch of games,
+// tables or rows chosen by the caller). At the start every worker gets an
+// equal share of the blocks in its own deque. A worker takes ranges from
+// the back of its deque and halves them, pushing the upper half back, until
+// one block is left to run. A worker whose deque is empty steals from the
+// front of another deque, where the largest ranges are, so a worker that
+// drew slow blocks (Dragon fights, long hit sequences) gets help instead of
+// holding up the whole job.
+//
+// A block is the unit of randomness as well: seeding a block's generator
+// from its index keeps results independent of which worker ran it. The
+// worker index passed to the body selects the worker's own output (see
+// PerWorker), so bodies never share writable state.
+//
+// The calling thread works as worker 0. Jobs must not start other jobs.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Jobs
+{
+    // blocks [begin, end)
+    struct Range
+    {
+        std::size_t begin{};
+        std::size_t end{};
+
+        std::size_t size() const { return end - begin; }
+    };
+
+    // One worker's deque. The owner pushes and pops at the back, thieves
+    // take from the front. Each deque has its own lock and is only
+    // contended by steals, which happen once per large range
+    class alignas(64) Deque
+    {
+        std::mutex m_mutex;
+        std::deque<Range> m_ranges;
+
+    public:
+        void push(Range r)
+        {
+            std::lock_guard lock{ m_mutex };
+            m_ranges.push_back(r);
+        }
+
+        bool pop(Range& r)
+        {
+            std::lock_guard lock{ m_mutex };
+            if (m_ranges.empty())
+                return false;
+            r = m_ranges.back();
+            m_ranges.pop_back();
+            return true;
+        }
+
+        bool steal(Range& r)
+        {
+            std::lock_guard lock{ m_mutex };
+            if (m_ranges.empty())
+                return false;
+            r = m_ranges.front();
+            m_ranges.pop_front();
+            return true;
+        }
+    };
+
+    struct WorkerStats
+    {
+        std::uint64_t blocks{0};
+        std::uint64_t steals{0};
+        double busy{0};   // seconds spent in job bodies
+    };
+
+    class Runtime
+    {
+        struct Job
+        {
+            virtual ~Job() = default;
+            virtual void run(std::size_t block, int worker) = 0;
+        };
+
+        template <typename F>
+        struct Body : Job
+        {
+            F& f;
+            explicit Body(F& fn) : f{fn} {}
+            void run(std::size_t block, int worker) override { f(block, worker); }
+        };
+
+        struct alignas(64) Worker
+        {
+            Deque deque;
+            WorkerStats stats;
+        };
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::vector<std::thread> m_threads;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        Job* m_job{nullptr};
+        std::uint64_t m_generation{0};
+        int m_joined{0};   // helper threads finished with the current job
+        bool m_stop{false};
+
+        std::atomic<std::size_t> m_remaining{0};
+
+        bool take(int w, Range& r)
+        {
+            Worker& self{ *m_workers[static_cast<std::size_t>(w)] };
+            if (self.deque.pop(r))
+                return true;
+
+            const int n{ workers() };
+            for (int k = 1; k < n; ++k)
+            {
+                if (m_workers[static_cast<std::size_t>((w + k) % n)]->deque.steal(r))
+                {
+                    ++self.stats.steals;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void work(int w, Job& job)
+        {
+            Worker& self{ *m_workers[static_cast<std::size_t>(w)] };
+            while (m_remaining.load(std::memory_order_acquire) > 0)
+            {
+                Range r;
+                if (!take(w, r))
+                {
+                    // the last blocks are running on other workers
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                while (r.size() > 1)
+                {
+                    std::size_t mid{ r.begin + r.size() / 2 };
+                    self.deque.push(Range{mid, r.end});
+                    r.end = mid;
+                }
+
+                auto begin{ std::chrono::steady_clock::now() };
+                job.run(r.begin, w);
+                self.stats.busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                ++self.stats.blocks;
+                m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+
+        void helper(int w)
+        {
+            std::uint64_t seen{0};
+            while (true)
+            {
+                Job* job{nullptr};
+                {
+                    std::unique_lock lock{ m_mutex };
+                    m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+                    if (m_stop)
+                        return;
+                    seen = m_generation;
+                    job = m_job;
+                }
+
+                work(w, *job);
+
+                {
+                    std::lock_guard lock{ m_mutex };
+                    ++m_joined;
+                }
+                m_done.notify_one();
+            }
+        }
+
+    public:
+        explicit Runtime(int workers)
+        {
+            workers = std::max(1, workers);
+            for (int w = 0; w < workers; ++w)
+                m_workers.push_back(std::make_unique<Worker>());
+            for (int w = 1; w < workers; ++w)
+                m_threads.emplace_back([this, w] { helper(w); });
+        }
+
+        ~Runtime()
+        {
+            {
+                std::lock_guard lock{ m_mutex };
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            for (auto& t : m_threads)
+                t.join();
+        }
+
+        Runtime(const Runtime&) = delete;
+        Runtime& operator=(const Runtime&) = delete;
+
+        int workers() const { return static_cast<int>(m_workers.size()); }
+
+        // Calls body(block, worker) for every block and returns when all have run
+        template <typename F>
+        void parallelFor(std::size_t blocks, F&& body)
+        {
+            if (blocks == 0)
+                return;
+
+            Body<F> job{ body };
+            const std::size_t n{ m_workers.size() };
+            for (std::size_t w = 0; w < n; ++w)
+            {
+                Range share{ blocks * w / n, blocks * (w + 1) / n };
+                if (share.size() > 0)
+                    m_workers[w]->deque.push(share);
+            }
+            m_remaining.store(blocks, std::memory_order_release);
+
+            {
+                std::lock_guard lock{ m_mutex };
+                m_job = &job;
+                m_joined = 0;
+                ++m_generation;
+            }
+            m_wake.notify_all();
+
+            work(0, job);
+
+            // every helper has seen this job before the next one can start
+            std::unique_lock lock{ m_mutex };
+            m_done.wait(lock, [&] { return m_joined == static_cast<int>(m_threads.size()); });
+            m_job = nullptr;
+        }
+
+        std::vector<WorkerStats> stats() const
+        {
+            std::vector<WorkerStats> s;
+            for (const auto& w : m_workers)
+                s.push_back(w->stats);
+            return s;
+        }
+
+        void resetStats()
+        {
+            for (auto& w : m_workers)
+                w->stats = WorkerStats{};
+        }
+    };
+
+    // One value per worker, each on its own cache lines
+    template <typename T>
+    class PerWorker
+    {
+        struct alignas(64) Slot
+        {
+            T value;
+        };
+
+        std::vector<Slot> m_slots;
+
+    public:
+        explicit PerWorker(const Runtime& runtime)
+            : m_slots(static_cast<std::size_t>(runtime.workers()))
+        {}
+
+        PerWorker(const Runtime& runtime, const T& init)
+            : m_slots(static_cast<std::size_t>(runtime.workers()), Slot{init})
+        {}
+
+        T& operator[](int worker) { return m_slots[static_cast<std::size_t>(worker)].value; }
+
+        template <typename F>
+        void forEach(F&& f)
+        {
+            for (auto& s : m_slots)
+                f(s.value);
+        }
+    };
+
+    // Share of the wall time the workers spent in job bodies
+    inline double efficiency(const std::vector<WorkerStats>& stats, double seconds)
+    {
+        double busy{0};
+        for (const auto& s : stats)
+            busy += s.busy;
+        return seconds > 0 && !stats.empty() ? busy / (seconds * static_cast<double>(stats.size())) : 0.0;
+    }
+
+    // Runs the same job on 1, 2, 4 ... maxThreads workers and prints the
+    // throughput of each. run(runtime) returns a summary of its result,
+    // which must not change with the number of workers
+    template <typename F>
+    void scaling(int maxThreads, double units, const char* unitName, F&& run)
+    {
+        std::cout << "throughput in millions of " << unitName << " per second\n";
+        std::cout << "threads   seconds       M/s   speedup   busy    steals     result\n";
+        double base{0};
+        for (int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            Runtime runtime{ threads };
+            auto begin{ std::chrono::steady_clock::now() };
+            double result{ run(runtime) };
+            double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() };
+            if (threads == 1)
+                base = seconds;
+
+            std::uint64_t steals{0};
+            for (const auto& s : runtime.stats())
+                steals += s.steals;
+            std::cout << std::fixed << std::setw(7) << threads << std::setprecision(3) << std::setw(10) << seconds
+                      << std::setprecision(2) << std::setw(10) << units / seconds / 1e6 << std::setw(10) << base / seconds << std::setw(6)
+                      << 100.0 * efficiency(runtime.stats(), seconds) << '%' << std::setw(10) << steals
+                      << std::setprecision(6) << std::setw(11) << result << '\n';
+        }
+        std::cout << "(" << std::thread::hardware_concurrency() << " hardware threads)\n";
+    }
+}
@@ -1,10 +1,23 @@
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <chrono>
 #include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "ColumnStore.h"
+#include "Convergence.h"
+#include "JobRuntime.h"
+#include "Trace.h"
 
 namespace Random
 {
@@ -21,7 +34,8 @@ namespace Random
 		return std::mt19937{ ss };
 	}
 
-	inline std::mt19937 mt{ generate() }; 
+	// one generator per thread, so simulations can run games in parallel
+	inline thread_local std::mt19937 mt{ generate() };
 
 	// Generate a random int between [min, max] (inclusive)
 	inline int get(int min, int max)
@@ -44,6 +58,13 @@ namespace Random
 	}
 }
 
+namespace Rules
+{
+    constexpr int winLevel{ 20 };       // level that wins the game
+    constexpr int potionChance{ 30 };   // chance of a potion after a kill, percent
+    constexpr int fleeOdds{ 2 };        // running away succeeds one time in fleeOdds
+}
+
 class Elixir
 {
 public:
@@ -105,6 +126,97 @@ public:
     }
 };
 
+// Game content known at compile time: one descriptor type per species and
+// one per potion. Monster::data and Hero::drink() are built from them, and
+// the simulation code below instantiates a fight per species, so the
+// stats become constants in the generated code.
+namespace Content
+{
+    enum Species
+    {
+        dragon,
+        orc,
+        slime,
+        max_species
+    };
+
+    struct Dragon
+    {
+        static constexpr Species species{dragon};
+        static constexpr std::string_view name{"Dragon"};
+        static constexpr char token{'D'};
+        static constexpr int hp{20}, attack{4}, gold{100};
+    };
+
+    struct Orc
+    {
+        static constexpr Species species{orc};
+        static constexpr std::string_view name{"Orc"};
+        static constexpr char token{'o'};
+        static constexpr int hp{4}, attack{2}, gold{25};
+    };
+
+    struct Slime
+    {
+        static constexpr Species species{slime};
+        static constexpr std::string_view name{"Slime"};
+        static constexpr char token{'s'};
+        static constexpr int hp{1}, attack{1}, gold{10};
+    };
+
+    template <typename... S>
+    struct Bestiary
+    {
+        static constexpr int size{ sizeof...(S) };
+    };
+
+    // true if every descriptor's species is its index in the pack
+    template <typename... S>
+    constexpr bool inSpeciesOrder(Bestiary<S...>)
+    {
+        int i{0};
+        return ((S::species == i++) && ...);
+    }
+
+    using Monsters = Bestiary<Dragon, Orc, Slime>;
+    static_assert(Monsters::size == max_species, "Content::Monsters must list every species");
+    static_assert(inSpeciesOrder(Monsters{}), "Content::Monsters must be in the order of Content::Species");
+
+    // what drinking a potion changes
+    struct Effect
+    {
+        int hp;
+        int attack;
+    };
+
+    template <Elixir::Kind K, Elixir::Volume V>
+    struct Potion;
+
+    template <Elixir::Volume V>
+    struct Potion<Elixir::heal, V> { static constexpr Effect effect{ V == Elixir::huge ? 5 : 2, 0 }; };
+
+    template <Elixir::Volume V>
+    struct Potion<Elixir::power, V> { static constexpr Effect effect{ 0, 1 }; };
+
+    template <Elixir::Volume V>
+    struct Potion<Elixir::venom, V> { static constexpr Effect effect{ -1, 0 }; };
+
+    template <std::size_t... I>
+    constexpr std::array<Effect, sizeof...(I)> makePotions(std::index_sequence<I...>)
+    {
+        return { Potion<static_cast<Elixir::Kind>(I / Elixir::max_volumes),
+                        static_cast<Elixir::Volume>(I % Elixir::max_volumes)>::effect... };
+    }
+
+    // effects of all potions, indexed by kind * max_volumes + volume
+    constexpr auto potions{ makePotions(std::make_index_sequence<Elixir::max_kinds * Elixir::max_volumes>{}) };
+
+    inline const Effect& effect(const Elixir& e)
+    {
+        return potions[e.kind() * Elixir::max_volumes + e.volume()];
+    }
+}
+
 class Creature
 {
 protected:
@@ -145,48 +257,41 @@ public:
     }
 
     int level() const { return m_level; }
-    bool won() const { return m_level >= 20; }
+    bool won() const { return m_level >= Rules::winLevel; }
 
     // applies a potion's effect
     void drink(const Elixir& e)
     {
-        switch (e.kind())
-        {
-        case Elixir::heal:
-            m_hp += (e.volume() == Elixir::huge ? 5 : 2);
-            break;
-        case Elixir::power:
-            ++m_attack;
-            break;
-        case Elixir::venom:
-            loseHp(1);
-            break;
-        case Elixir::max_kinds:
-            break;
-        }
+        const Content::Effect& effect{ Content::effect(e) };
+        m_hp += effect.hp;
+        m_attack += effect.attack;
     }
 };
 
 class Monster : public Creature
 {
 public:
-    enum Species
-    {
-        dragon,
-        orc,
-        slime,
-        max_species
-    };
+    using Species = Content::Species;
+    static constexpr Species dragon{ Content::dragon };
+    static constexpr Species orc{ Content::orc };
+    static constexpr Species slime{ Content::slime };
+    static constexpr int max_species{ Content::max_species };
 
 private:
-    inline static const std::array<Creature, max_species> data {
-        Creature{"Dragon", 'D', 20, 4, 100},
-        Creature{"Orc",    'o',  4, 2,  25},
-        Creature{"Slime",  's',  1, 1,  10}
-    };
+    Species m_species{};
+
+    template <typename... S>
+    static std::array<Creature, max_species> makeData(Content::Bestiary<S...>)
+    {
+        return { Creature{S::name, S::token, S::hp, S::attack, S::gold}... };
+    }
+
+    inline static const std::array<Creature, max_species> data{ makeData(Content::Monsters{}) };
 
 public:
-    explicit Monster(Species s) : Creature{data[s]} {}
+    explicit Monster(Species s) : Creature{data[s]}, m_species{s} {}
+
+    Species species() const { return m_species; }
 
     static Monster random()
     {
@@ -195,96 +300,958 @@ public:
 };
 
 // Game Logic
-void rewardPlayer(Hero& h, const Monster& m)
+//
+// The game functions take a controller that makes the player's decisions.
+// Console asks the player and prints the story; simulations pass silent
+// controllers (verbose is false) so the same rules run without console I/O.
+// The controller is asked run(hero, species, monster hp) and
+// drink(hero, elixir). The fight functions also take the monster's type,
+// so the simulation build (Fast below) plays them with constant stats.
+
+// interactive play on the console
+struct Console
 {
-    std::cout << "You defeated the " << m.name() << "!\n";
+    static constexpr bool verbose{true};
+
+    bool run(const Hero&, int, int)
+    {
+        while (true)
+        {
+            std::cout << "(R)un or (F)ight: ";
+            char choice{};
+            Trace::read("run or fight", choice);
+
+            if (choice == 'R' || choice == 'r')
+                return true;
+            if (choice == 'F' || choice == 'f')
+                return false;
+        }
+    }
+
+    bool drink(const Hero&, const Elixir&)
+    {
+        std::cout << "You found a potion! Drink it? [y/n]: ";
+        char ch{};
+        Trace::read("drink", ch);
+        return ch == 'y' || ch == 'Y';
+    }
+};
+
+template <typename Io, typename M>
+void rewardPlayer(Hero& h, const M& m, Io& io)
+{
+    if constexpr (Io::verbose) std::cout << "You defeated the " << m.name() << "!\n";
     h.levelUp();
-    std::cout << "You are now level " << h.level() << ".\n";
+    if constexpr (Io::verbose) std::cout << "You are now level " << h.level() << ".\n";
     h.addGold(m.gold());
-    std::cout << "You looted " << m.gold() << " gold.\n";
+    if constexpr (Io::verbose) std::cout << "You looted " << m.gold() << " gold.\n";
 
     // chance of finding a potion
-    if (Random::get(1, 100) <= 30)
+    if (Random::get(1, 100) <= Rules::potionChance)
     {
         Elixir e{Elixir::random()};
-        std::cout << "You found a potion! Drink it? [y/n]: ";
-        char ch{};
-        std::cin >> ch;
-        if (ch == 'y' || ch == 'Y')
+        if (io.drink(h, e))
         {
             h.drink(e); // apply the effect
-            std::cout << "You drank " << e.fullName() << ".\n";
+            if constexpr (Io::verbose) std::cout << "You drank " << e.fullName() << ".\n";
         }
     }
 }
 
-void heroAttack(Hero& h, Monster& m)
+template <typename Io, typename M>
+void heroAttack(Hero& h, M& m, Io& io)
 {
     if (h.dead()) return; // if the player is dead, we can't attack the monster
 
-    std::cout << "You strike the " << m.name() << " for " << h.attack() << " damage.\n";
+    if constexpr (Io::verbose) std::cout << "You strike the " << m.name() << " for " << h.attack() << " damage.\n";
     m.loseHp(h.attack()); // reduce the monster's health by the player's damage
 
     // if the monster is dead, reward the player
     if (m.dead())
-        rewardPlayer(h, m);
+        rewardPlayer(h, m, io);
 }
 
-void monsterAttack(const Monster& m, Hero& h)
+template <typename Io, typename M>
+void monsterAttack(const M& m, Hero& h)
 {
     if (m.dead()) return; // if the monster is dead, it can't attack the player
     h.loseHp(m.attack()); // reduce the player's health by the monster's damage
-    std::cout << "The " << m.name() << " hits you for " << m.attack() << " damage.\n";
+    if constexpr (Io::verbose) std::cout << "The " << m.name() << " hits you for " << m.attack() << " damage.\n";
 }
 
-// this function handles the entire fight between a player and a randomly generated monster
-void encounter(Hero& h)
+// A controller may promise to fight a species to the end with
+// commits(hero, species). Such fights have no decisions and no random
+// events before the kill, so they are resolved without stepping the rounds.
+template <typename Io, typename = void>
+struct CanCommit : std::false_type {};
+
+template <typename Io>
+struct CanCommit<Io, std::void_t<decltype(std::declval<const Io&>().commits(std::declval<const Hero&>(), 0))>>
+    : std::true_type {};
+
+// Outcome of a fight to the end in O(1). The hero strikes first, so the
+// monster hits once less than the strikes needed to kill it, unless the
+// hero falls before that. Same result as the rounds of encounter()
+template <typename Io, typename M>
+void resolveFight(Hero& h, const M& m, Io& io)
 {
-    Monster m{ Monster::random() };
-    std::cout << "A wild " << m.name() << " (" << m.token() << ") appears!\n";
+    static_assert(!Io::verbose, "resolved fights print nothing");
+
+    int strikes{ (m.hp() + h.attack() - 1) / h.attack() };   // to kill the monster
+    int endured{ (h.hp() - 1) / m.attack() };                // hits the hero survives
+    if (endured < strikes - 1)
+    {
+        h.loseHp((endured + 1) * m.attack());
+        return;
+    }
+
+    h.loseHp((strikes - 1) * m.attack());
+    rewardPlayer(h, m, io);
+}
+
+// this function handles the fight between a player and a monster
+template <typename Io, typename M>
+void fight(Hero& h, M& m, Io& io)
+{
+    if constexpr (CanCommit<Io>::value)
+    {
+        if (h.attack() > 0 && io.commits(h, m.species()))
+        {
+            resolveFight(h, m, io);
+            return;
+        }
+    }
 
     // the fight continues while the monster and the player alive 
     while (!m.dead() && !h.dead())
     {
-        std::cout << "(R)un or (F)ight: ";
-        char choice{};
-        std::cin >> choice;
-
-        if (choice == 'R' || choice == 'r')
+        if (io.run(h, m.species(), m.hp()))
         {
             // 50% chance of fleeing successfully
-            if (Random::get(1, 2) == 1)
+            if (Random::get(1, Rules::fleeOdds) == 1)
             {
-                std::cout << "You escaped!\n";
+                if constexpr (Io::verbose) std::cout << "You escaped!\n";
                 return;
             }
             else
             {
                 // failure to flee gives the monster a free attack on the player
-                std::cout << "You failed to run!\n";
-                monsterAttack(m, h);
+                if constexpr (Io::verbose) std::cout << "You failed to run!\n";
+                monsterAttack<Io>(m, h);
                 continue;
             }
         }
-        else if (choice == 'F' || choice == 'f')
+        else
         {
-            heroAttack(h, m);
-            monsterAttack(m, h);
+            heroAttack(h, m, io);
+            monsterAttack<Io>(m, h);
         }
     }
 }
 
-int main()
+// a randomly generated monster appears
+template <typename Io>
+void encounter(Hero& h, Io& io)
+{
+    Monster m{ Monster::random() };
+    if constexpr (Io::verbose) std::cout << "A wild " << m.name() << " (" << m.token() << ") appears!\n";
+    fight(h, m, io);
+}
+
+// plays encounters until the hero wins or dies
+template <typename Io>
+void playGame(Hero& hero, Io& io)
+{
+    while (!hero.dead() && !hero.won())
+        encounter(hero, io);
+}
+
+// Exact solution of the game by dynamic programming.
+//
+// A state between encounters is (level, hp, attack). During a fight it also
+// includes the monster's species and remaining hp. Every transition lowers
+// the hero's hp, kills the monster (level + 1) or, after a successful run,
+// returns to the same state, so the levels are solved from the top down,
+// hp from the bottom up, and the value of a state only depends on itself
+// through a run. That one unknown is found by value iteration. Attack values
+// of one level do not depend on each other and are solved in parallel.
+//
+// Stats, rewards, potion effects and odds come from Monster, Hero::drink()
+// and Rules, so the solution follows the code of encounter(), heroAttack(),
+// monsterAttack() and rewardPlayer().
+namespace Solver
 {
+    enum class Objective { win, gold };
+
+    constexpr int elixirs{ Elixir::max_kinds * Elixir::max_volumes };
+
+    // bounds of the state space (the largest values a hero can reach)
+    struct Bounds
+    {
+        int levels{ Rules::winLevel };   // 1 .. winLevel - 1 are playable
+        int maxAttack{};
+        int maxHp{};
+        int maxMonsterHp{};
+
+        // growth per kill: the level up and the best potion
+        int startAttack{}, startHp{};
+        int attackPerKill{}, hpPerKill{};
+
+        int maxAttackAt(int level) const { return startAttack + (level - 1) * attackPerKill; }
+        int maxHpAt(int level) const { return startHp + (level - 1) * hpPerKill; }
+    };
+
+    // decisions for every state: run (1) or fight (0), drink (1) or not (0)
+    struct Policy
+    {
+        Bounds b{};
+        std::vector<std::uint8_t> run{};
+        std::vector<std::uint8_t> drink{};
+
+        std::size_t runIndex(int level, int attack, int hp, int species, int monsterHp) const
+        {
+            return ((((static_cast<std::size_t>(level) * (b.maxAttack + 1) + attack) * (b.maxHp + 1) + hp)
+                     * Monster::max_species + species) * (b.maxMonsterHp + 1) + monsterHp);
+        }
+
+        // state right after the level up, before drinking
+        std::size_t drinkIndex(int level, int attack, int hp, int elixir) const
+        {
+            return (((static_cast<std::size_t>(level) * (b.maxAttack + 1) + attack) * (b.maxHp + 1) + hp)
+                    * elixirs + elixir);
+        }
+
+        // state at the start of an encounter
+        std::size_t commitIndex(int level, int attack, int hp, int species) const
+        {
+            return ((static_cast<std::size_t>(level) * (b.maxAttack + 1) + attack) * (b.maxHp + 1) + hp)
+                   * Monster::max_species + species;
+        }
+
+        // 1 where the policy never runs from the species until the fight ends
+        std::vector<std::uint8_t> commit{};
+        // the policy never runs at all, so commit is 1 everywhere
+        bool commitsAll{false};
+    };
+
+    // Follows every fight from its start along the rounds the policy
+    // fights and marks the ones that never reach a run decision
+    void markCommitted(Policy& p)
+    {
+        const Bounds& b{ p.b };
+        p.commitsAll = std::none_of(p.run.begin(), p.run.end(), [](std::uint8_t r) { return r != 0; });
+        p.commit.assign(p.commitIndex(b.levels, 0, 0, 0), 0);
+        for (int level = 1; level < b.levels; ++level)
+        {
+            for (int attack = 1; attack <= b.maxAttackAt(level); ++attack)
+            {
+                for (int hp = 1; hp <= b.maxHpAt(level); ++hp)
+                {
+                    for (int s = 0; s < Monster::max_species; ++s)
+                    {
+                        const Monster m{ static_cast<Monster::Species>(s) };
+                        int heroHp{ hp }, monsterHp{ m.hp() };
+                        bool committed{ true };
+                        while (heroHp > 0 && monsterHp > 0)
+                        {
+                            if (p.run[p.runIndex(level, attack, heroHp, s, monsterHp)])
+                            {
+                                committed = false;
+                                break;
+                            }
+                            monsterHp -= attack;
+                            if (monsterHp > 0)
+                                heroHp -= m.attack();
+                        }
+                        p.commit[p.commitIndex(level, attack, hp, s)] = committed;
+                    }
+                }
+            }
+        }
+    }
+
+    struct Solution
+    {
+        Policy policy{};
+        std::vector<double> value{};   // value between encounters, [level][attack][hp]
+        double start{};                // value of a new hero
+        double seconds{};
+    };
+
+    Bounds bounds()
+    {
+        Bounds b;
+        Hero probe{""};
+        int heal{0}, strength{0};
+        for (int k = 0; k < Elixir::max_kinds; ++k)
+        {
+            for (int v = 0; v < Elixir::max_volumes; ++v)
+            {
+                Hero h{""};
+                h.drink(Elixir{static_cast<Elixir::Kind>(k), static_cast<Elixir::Volume>(v)});
+                heal = std::max(heal, h.hp() - probe.hp());
+                strength = std::max(strength, h.attack() - probe.attack());
+            }
+        }
+        Hero leveled{""};
+        leveled.levelUp();
+
+        // one level up and at most one potion per kill
+        b.startAttack = probe.attack();
+        b.startHp = probe.hp();
+        b.attackPerKill = leveled.attack() - probe.attack() + strength;
+        b.hpPerKill = heal;
+        b.maxAttack = b.maxAttackAt(Rules::winLevel);
+        b.maxHp = b.maxHpAt(Rules::winLevel);
+        for (int s = 0; s < Monster::max_species; ++s)
+            b.maxMonsterHp = std::max(b.maxMonsterHp, Monster{static_cast<Monster::Species>(s)}.hp());
+        return b;
+    }
+
+    // Solves for the best policy, or evaluates the given one if fixed is set
+    Solution solve(Objective objective, Jobs::Runtime& runtime, const Policy* fixed = nullptr)
+    {
+        auto begin{ std::chrono::steady_clock::now() };
+        Solution sol;
+        Policy& pol{ sol.policy };
+        const Bounds b{ bounds() };
+        pol.b = b;
+        pol.run.assign(pol.runIndex(b.levels, 0, 0, 0, 0), 0);
+        pol.drink.assign(pol.drinkIndex(b.levels + 1, 0, 0, 0), 0);
+
+        const std::size_t hpStride{ static_cast<std::size_t>(b.maxHp) + 1 };
+        const std::size_t attackStride{ hpStride * (static_cast<std::size_t>(b.maxAttack) + 1) };
+        sol.value.assign(attackStride * (static_cast<std::size_t>(b.levels) + 1), 0.0);
+
+        std::array<Monster, Monster::max_species> monsters{
+            Monster{Monster::dragon}, Monster{Monster::orc}, Monster{Monster::slime}
+        };
+        const double flee{ 1.0 / Rules::fleeOdds };
+        const double potion{ Rules::potionChance / 100.0 };
+
+        // value of a state between encounters (terminal states included)
+        auto stateValue = [&](int level, int attack, int hp) -> double {
+            if (hp <= 0)
+                return 0.0;
+            if (level >= Rules::winLevel)
+                return objective == Objective::win ? 1.0 : 0.0;
+            return sol.value[level * attackStride + attack * hpStride + hp];
+        };
+
+        // what Hero::levelUp() and Hero::drink() change (they do not depend on the state)
+        int levelUpAttack{};
+        {
+            Hero h{""};
+            h.levelUp();
+            levelUpAttack = h.attack() - Hero{""}.attack();
+        }
+        std::array<std::pair<int, int>, elixirs> effect{};   // hp, attack
+        for (int e = 0; e < elixirs; ++e)
+        {
+            Hero h{""};
+            h.drink(Elixir{ static_cast<Elixir::Kind>(e / Elixir::max_volumes),
+                            static_cast<Elixir::Volume>(e % Elixir::max_volumes) });
+            effect[e] = { h.hp() - Hero{""}.hp(), h.attack() - Hero{""}.attack() };
+        }
+
+        // value after killing a monster: level up, gold and maybe a potion
+        auto afterKill = [&](int level, int attack, int hp, const Monster& m) -> double {
+            const int newLevel{ level + 1 };
+            const int newAttack{ attack + levelUpAttack };
+
+            double noPotion{ stateValue(newLevel, newAttack, hp) };
+            double withPotion{0};
+            for (int e = 0; e < elixirs; ++e)
+            {
+                double drunk{ stateValue(newLevel, newAttack + effect[e].second, hp + effect[e].first) };
+
+                std::size_t di{ pol.drinkIndex(newLevel, newAttack, hp, e) };
+                bool drink{ fixed ? fixed->drink[di] != 0 : drunk > noPotion };
+                pol.drink[di] = drink;
+                withPotion += drink ? drunk : noPotion;
+            }
+            withPotion /= elixirs;
+
+            double gold{ objective == Objective::gold ? static_cast<double>(m.gold()) : 0.0 };
+            return gold + (1.0 - potion) * noPotion + potion * withPotion;
+        };
+
+        // values during a fight for one (level, attack), indexed [hp][species][monster hp].
+        // Only hp and attack values reachable at this level are solved, so
+        // every state after a kill is inside the bounds of the next level
+        auto solveBlock = [&](int level, int attack, std::vector<double>& fight) {
+            const std::size_t mStride{ static_cast<std::size_t>(b.maxMonsterHp) + 1 };
+            const std::size_t sStride{ mStride * Monster::max_species };
+            fight.assign(sStride * hpStride, 0.0);
+            auto fightValue = [&](int hp, int s, int mhp) -> double {
+                return hp <= 0 ? 0.0 : fight[hp * sStride + s * mStride + mhp];
+            };
+
+            std::array<double, Monster::max_species> killValue{};
+
+            for (int hp = 1; hp <= b.maxHpAt(level); ++hp)
+            {
+                for (int s = 0; s < Monster::max_species; ++s)
+                    killValue[s] = afterKill(level, attack, hp, monsters[s]);
+
+                // everything except a successful run is already known
+                double x{0};
+                for (int iter = 0; iter < 200; ++iter)
+                {
+                    double next{0};
+                    for (int s = 0; s < Monster::max_species; ++s)
+                    {
+                        const Monster& m{ monsters[s] };
+                        for (int mhp = 1; mhp <= m.hp(); ++mhp)
+                        {
+                            double fightOn{ mhp - attack <= 0 ? killValue[s]
+                                                              : fightValue(hp - m.attack(), s, mhp - attack) };
+                            double runAway{ flee * x + (1.0 - flee) * fightValue(hp - m.attack(), s, mhp) };
+
+                            std::size_t ri{ pol.runIndex(level, attack, hp, s, mhp) };
+                            bool run{ fixed ? fixed->run[ri] != 0 : runAway > fightOn };
+                            pol.run[ri] = run;
+                            fight[hp * sStride + s * mStride + mhp] = run ? runAway : fightOn;
+                        }
+                        next += fight[hp * sStride + s * mStride + m.hp()];
+                    }
+                    next /= Monster::max_species;
+                    bool done{ std::abs(next - x) <= 1e-13 * std::max(1.0, std::abs(next)) };
+                    x = next;
+                    if (done)
+                        break;
+                }
+                sol.value[level * attackStride + attack * hpStride + hp] = x;
+            }
+        };
+
+        // the attack values of a level only depend on the level above
+        Jobs::PerWorker<std::vector<double>> fight{ runtime };
+        for (int level = b.levels - 1; level >= 1; --level)
+        {
+            runtime.parallelFor(static_cast<std::size_t>(b.maxAttackAt(level)), [&](std::size_t block, int worker) {
+                solveBlock(level, static_cast<int>(block) + 1, fight[worker]);
+            });
+        }
+
+        markCommitted(pol);
+
+        Hero h{""};
+        sol.start = stateValue(h.level(), h.attack(), h.hp());
+        sol.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return sol;
+    }
+
+    // always fights and drinks everything except poison
+    Policy fightAlways()
+    {
+        Policy p;
+        p.b = bounds();
+        p.run.assign(p.runIndex(p.b.levels, 0, 0, 0, 0), 0);
+        p.drink.assign(p.drinkIndex(p.b.levels + 1, 0, 0, 0), 0);
+        for (std::size_t i = 0; i < p.drink.size(); ++i)
+            p.drink[i] = (i % elixirs) / Elixir::max_volumes != Elixir::venom;
+        markCommitted(p);
+        return p;
+    }
+}
+
+// plays by a solver policy without console output
+struct PolicyPlay
+{
+    static constexpr bool verbose{false};
+    const Solver::Policy* policy{};
+
+    bool run(const Hero& h, int species, int monsterHp) const
+    {
+        return policy->run[policy->runIndex(h.level(), h.attack(), h.hp(), species, monsterHp)] != 0;
+    }
+
+    bool drink(const Hero& h, const Elixir& e) const
+    {
+        int elixir{ e.kind() * Elixir::max_volumes + e.volume() };
+        return policy->drink[policy->drinkIndex(h.level(), h.attack(), h.hp(), elixir)] != 0;
+    }
+
+    // a policy that never runs commits to every fight without a lookup
+    bool commits(const Hero& h, int species) const
+    {
+        return policy->commitsAll || policy->commit[policy->commitIndex(h.level(), h.attack(), h.hp(), species)] != 0;
+    }
+};
+
+// Simulation build of the game for a compile-time content pack. Foe<S>
+// stands in for Monster with the stats of species S as constants and the
+// hp as a plain int, and the encounter picks one by the same random number
+// as Monster::random(). The rounds and rewards are the game functions
+// above, instantiated per species, so the generated fight loops have the
+// stats folded in while the rules exist once.
+namespace Fast
+{
+    template <typename S>
+    class Foe
+    {
+        int m_hp{ S::hp };
+
+    public:
+        static constexpr std::string_view name() { return S::name; }
+        static constexpr Content::Species species() { return S::species; }
+        static constexpr int attack() { return S::attack; }
+        static constexpr int gold() { return S::gold; }
+
+        int hp() const { return m_hp; }
+        bool dead() const { return m_hp <= 0; }
+        void loseHp(int dmg) { m_hp -= dmg; }
+    };
+
+    template <typename S, typename Io>
+    void fight(Hero& h, Io& io)
+    {
+        Foe<S> m;
+        ::fight(h, m, io);
+    }
+
+    template <typename Io, typename... S, std::size_t... I>
+    void encounter(Hero& h, Io& io, Content::Bestiary<S...>, std::index_sequence<I...>)
+    {
+        int pick{ Random::get(0, static_cast<int>(sizeof...(S)) - 1) };
+        ((pick == static_cast<int>(I) ? fight<S>(h, io) : void()), ...);
+    }
+
+    template <typename Pack, typename Io>
+    void playGame(Hero& hero, Io& io)
+    {
+        while (!hero.dead() && !hero.won())
+            encounter(hero, io, Pack{}, std::make_index_sequence<Pack::size>{});
+    }
+}
+
+// runs from dragons, fights everything else and drinks all but poison
+struct Cautious
+{
+    static constexpr bool verbose{false};
+
+    bool run(const Hero&, int species, int) const { return species == Monster::dragon; }
+    bool drink(const Hero&, const Elixir& e) const { return e.kind() != Elixir::venom; }
+    bool commits(const Hero&, int species) const { return species != Monster::dragon; }
+};
+
+// Passes decisions to another controller but never commits, so every
+// fight is played round by round
+template <typename Io>
+struct Stepping
+{
+    static constexpr bool verbose{ Io::verbose };
+    const Io& io;
+
+    bool run(const Hero& h, int species, int monsterHp) const { return io.run(h, species, monsterHp); }
+    bool drink(const Hero& h, const Elixir& e) const { return io.drink(h, e); }
+};
+
+// results of consecutive games from one seed
+struct GameTotals
+{
+    long wins{0};
+    long gold{0};
+    long levels{0};
+    double seconds{0};
+
+    bool operator==(const GameTotals& o) const { return wins == o.wins && gold == o.gold && levels == o.levels; }
+};
+
+// seeds the generator and plays games with play(hero), timing them
+template <typename F>
+GameTotals playSeeded(long games, std::uint32_t seed, F&& play)
+{
+    GameTotals t;
+    std::seed_seq seq{ seed };
+    Random::mt.seed(seq);
+    auto begin{ std::chrono::steady_clock::now() };
+    for (long g = 0; g < games; ++g)
+    {
+        Hero hero{""};
+        play(hero);
+        t.wins += !hero.dead();
+        t.gold += hero.gold();
+        t.levels += hero.level();
+    }
+    t.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return t;
+}
+
+// Plays the same seeded games through the runtime game code and through
+// the compile-time content pack, checks that they agree and compares speed
+int benchMain(int argc, char* argv[])
+{
+    long games{ argc > 2 ? std::stol(argv[2]) : 1000000 };
+    std::uint32_t seed{ argc > 3 ? static_cast<std::uint32_t>(std::stoul(argv[3])) : 1u };
+
+    Cautious io;
+    GameTotals runtime{ playSeeded(games, seed, [&](Hero& h) { playGame(h, io); }) };
+    GameTotals compiled{ playSeeded(games, seed, [&](Hero& h) { Fast::playGame<Content::Monsters>(h, io); }) };
+
+    bool same{ runtime == compiled };
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "games:         " << games << " (seed " << seed << ")\n";
+    std::cout << "results:       " << (same ? "identical" : "DIFFERENT") << " (" << runtime.wins << " wins, "
+              << runtime.gold << " gold)\n";
+    std::cout << "runtime data:  " << runtime.seconds << " s, " << games / runtime.seconds / 1e6 << " M games/s\n";
+    std::cout << "compile-time:  " << compiled.seconds << " s, " << games / compiled.seconds / 1e6 << " M games/s\n";
+    std::cout << "speedup:       " << std::setprecision(2) << runtime.seconds / compiled.seconds << "x\n";
+    return same ? 0 : 1;
+}
+
+// fights every monster to the end and drinks all but poison
+struct FightOn
+{
+    static constexpr bool verbose{false};
+
+    bool run(const Hero&, int, int) const { return false; }
+    bool drink(const Hero&, const Elixir& e) const { return e.kind() != Elixir::venom; }
+    bool commits(const Hero&, int) const { return true; }
+};
+
+// Differential check of the resolved fights against the round-by-round
+// loop. Every reachable hero state fights every species both ways from the
+// same seed, and the hero and the generator must end up the same. Then
+// whole games are played both ways by controllers that commit to some
+// fights only
+int verifyMain(int argc, char* argv[])
+{
+    long games{ argc > 2 ? std::stol(argv[2]) : 100000 };
+    std::uint32_t seed{ argc > 3 ? static_cast<std::uint32_t>(std::stoul(argv[3])) : 1u };
+
+    const Solver::Bounds b{ Solver::bounds() };
+    const Content::Effect& strength{ Content::effect(Elixir{Elixir::power, Elixir::normal}) };
+    const Content::Effect& poison{ Content::effect(Elixir{Elixir::venom, Elixir::normal}) };
+
+    // a hero in the given state, reached through level ups and potions
+    auto makeHero = [&](int level, int attack, int hp) {
+        Hero h{""};
+        while (h.level() < level)
+            h.levelUp();
+        while (h.attack() < attack)
+            h.drink(Elixir{Elixir::power, Elixir::normal});
+        while (h.hp() < hp)
+            h.drink(Elixir{Elixir::heal, Elixir::tiny});
+        while (h.hp() > hp)
+            h.drink(Elixir{Elixir::venom, Elixir::tiny});
+        return h;
+    };
+
+    auto same = [](const Hero& a, const Hero& b) {
+        return a.hp() == b.hp() && a.attack() == b.attack() && a.level() == b.level() && a.gold() == b.gold();
+    };
+
+    long fights{0}, mismatches{0};
+    if (strength.attack > 0 && poison.hp < 0)
+    {
+        FightOn io;
+        Stepping<FightOn> stepped{ io };
+        for (int level = 1; level < b.levels; ++level)
+        {
+            for (int attack = level; attack <= b.maxAttackAt(level); ++attack)
+            {
+                for (int hp = 1; hp <= b.maxHpAt(level); ++hp)
+                {
+                    const Hero start{ makeHero(level, attack, hp) };
+                    for (int s = 0; s < Monster::max_species; ++s)
+                    {
+                        std::seed_seq seq{ seed, static_cast<std::uint32_t>(fights) };
+                        Random::mt.seed(seq);
+                        const std::mt19937 origin{ Random::mt };
+
+                        Hero a{ start };
+                        Monster ma{ static_cast<Monster::Species>(s) };
+                        fight(a, ma, stepped);
+                        const std::mt19937 afterStepped{ Random::mt };
+
+                        Random::mt = origin;
+                        Hero r{ start };
+                        Monster mr{ static_cast<Monster::Species>(s) };
+                        fight(r, mr, io);
+
+                        if (!same(a, r) || Random::mt != afterStepped)
+                        {
+                            if (mismatches < 5)
+                                std::cout << "mismatch: level " << level << ", attack " << attack << ", hp " << hp
+                                          << ", " << ma.name() << ": stepped hp " << a.hp() << ", resolved hp "
+                                          << r.hp() << '\n';
+                            ++mismatches;
+                        }
+                        ++fights;
+                    }
+                }
+            }
+        }
+    }
+
+    auto measure = [&](auto play) { return playSeeded(games, seed, play); };
+
+    const Solver::Policy always{ Solver::fightAlways() };
+    PolicyPlay policy{ &always };
+    Stepping<PolicyPlay> policyStepped{ policy };
+    Cautious cautious;
+    Stepping<Cautious> cautiousStepped{ cautious };
+
+    struct Row
+    {
+        const char* name;
+        GameTotals stepped, resolved;
+    };
+    const Row rows[]{
+        {"always fight", measure([&](Hero& h) { playGame(h, policyStepped); }),
+                         measure([&](Hero& h) { playGame(h, policy); })},
+        {"cautious", measure([&](Hero& h) { playGame(h, cautiousStepped); }),
+                     measure([&](Hero& h) { playGame(h, cautious); })},
+        {"cautious, fast", measure([&](Hero& h) { Fast::playGame<Content::Monsters>(h, cautiousStepped); }),
+                           measure([&](Hero& h) { Fast::playGame<Content::Monsters>(h, cautious); })}
+    };
+
+    bool ok{ mismatches == 0 };
+    std::cout << "fights:  " << fights << " hero states x species, " << mismatches << " mismatches\n";
+    std::cout << "games:   " << games << " per controller (seed " << seed << ")\n\n";
+    std::cout << "controller        results      stepped M/s   resolved M/s\n";
+    std::cout << std::fixed << std::setprecision(3);
+    for (const Row& r : rows)
+    {
+        bool match{ r.stepped == r.resolved };
+        ok = ok && match;
+        std::cout << std::left << std::setw(18) << r.name << std::setw(10) << (match ? "identical" : "DIFFERENT")
+                  << std::right << std::setw(14) << games / r.stepped.seconds / 1e6
+                  << std::setw(15) << games / r.resolved.seconds / 1e6 << '\n';
+    }
+    return ok ? 0 : 1;
+}
+
+// Columns of stored games: one row per game. With a store every game
+// reseeds the generator with its own seed, so any row can be replayed
+struct GameColumns
+{
+    Columns::Schema schema{};
+    int seed{ schema.add("seed", Columns::Type::u32) };
+    int result{ schema.add("result", Columns::Type::u8) };   // 1 won, 0 died
+    int level{ schema.add("level", Columns::Type::u8) };
+    int hp{ schema.add("hp", Columns::Type::i16) };
+    int attack{ schema.add("attack", Columns::Type::u8) };
+    int gold{ schema.add("gold", Columns::Type::u32) };
+
+    static std::uint32_t gameSeed(std::uint32_t runSeed, long game)
+    {
+        return runSeed * 0x9E3779B9u + static_cast<std::uint32_t>(game);
+    }
+
+    bool store(Columns::Writer& out, std::uint32_t gameSeed, const Hero& h) const
+    {
+        if (!out.append())
+            return false;
+        out.set(seed, gameSeed);
+        out.set(result, static_cast<std::uint8_t>(!h.dead()));
+        out.set(level, static_cast<std::uint8_t>(h.level()));
+        out.set(hp, static_cast<std::int16_t>(h.hp()));
+        out.set(attack, static_cast<std::uint8_t>(h.attack()));
+        out.set(gold, static_cast<std::uint32_t>(h.gold()));
+        return true;
+    }
+};
+
+constexpr long blockGames{ 4096 };
+
+int solverMain(int argc, char* argv[])
+{
+    int threads{ static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };
+    long games{0};
+    std::uint32_t seed{1};
+    std::string store;
+    Convergence::Target target;
+    target.samples = "games";
+    target.value = "gold";
+    target.bins = 2048;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string_view arg{ argv[i] };
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << '\n';
+            return 1;
+        }
+        std::string value{ argv[++i] };
+        if (arg == "--threads") threads = std::stoi(value);
+        else if (arg == "--simulate") games = std::stol(value);
+        else if (arg == "--seed") seed = static_cast<std::uint32_t>(std::stoul(value));
+        else if (arg == "--store") store = value;
+        else if (arg == "--width") target.halfWidth = std::stod(value);
+        else if (arg == "--report") target.reportSeconds = std::stod(value);
+        else
+        {
+            std::cerr << "Unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+
+    using Solver::Objective;
+    Jobs::Runtime runtime{ threads };
+    Solver::Solution bestWin{ Solver::solve(Objective::win, runtime) };
+    Solver::Solution bestGold{ Solver::solve(Objective::gold, runtime) };
+    Solver::Policy naive{ Solver::fightAlways() };
+
+    struct Row
+    {
+        const char* name;
+        const Solver::Policy* policy;
+    };
+    const Row rows[]{
+        {"best win chance", &bestWin.policy},
+        {"most gold", &bestGold.policy},
+        {"always fight", &naive}
+    };
+
+    const Solver::Bounds& b{ bestWin.policy.b };
+    std::cout << "states: level 1-" << b.levels - 1 << ", attack 1-" << b.maxAttack << ", hp 1-" << b.maxHp
+              << "; solved in " << std::fixed << std::setprecision(3) << bestWin.seconds + bestGold.seconds
+              << " s on " << runtime.workers() << " threads\n\n";
+    std::cout << "policy            win chance   expected gold\n";
+    for (const Row& r : rows)
+    {
+        double win{ Solver::solve(Objective::win, runtime, r.policy).start };
+        double gold{ Solver::solve(Objective::gold, runtime, r.policy).start };
+        std::cout << std::left << std::setw(16) << r.name << std::right << std::setprecision(6)
+                  << std::setw(12) << win << std::setprecision(2) << std::setw(16) << gold << '\n';
+    }
+
+    // check the exact answer against games played with the real game code
+    if (games > 0)
+    {
+        Jobs::PerWorker<std::unique_ptr<Columns::Writer>> out{ runtime };
+        Jobs::PerWorker<char> storeOk{ runtime, 1 };
+        const GameColumns columns;
+        if (!store.empty())
+        {
+            Columns::clear(store);
+            for (int w = 0; w < runtime.workers(); ++w)
+                out[w] = std::make_unique<Columns::Writer>(Columns::segmentPath(store, w), columns.schema, seed);
+        }
+
+        // games are played in blocks; a block seeds the generator of the
+        // worker that runs it, or every game when the games are stored.
+        // With --width the games stop once the win rate is known that well
+        if (target.reportSeconds > 0)
+            std::cout << '\n';
+        Convergence::Monitor monitor{ runtime, target };
+        const long blocks{ (games + blockGames - 1) / blockGames };
+        runtime.parallelFor(static_cast<std::size_t>(blocks), [&](std::size_t block, int worker) {
+            if (monitor.stopped())
+                return;
+            const long first{ static_cast<long>(block) * blockGames };
+            const long last{ std::min(games, first + blockGames) };
+            PolicyPlay io{ &bestWin.policy };
+            if (store.empty())
+            {
+                std::seed_seq seq{ seed, static_cast<std::uint32_t>(block) };
+                Random::mt.seed(seq);
+                for (long g = first; g < last; ++g)
+                {
+                    Hero hero{""};
+                    playGame(hero, io);
+                    monitor.add(worker, !hero.dead(), hero.gold());
+                }
+                monitor.publish(worker);
+                return;
+            }
+
+            Columns::Writer& writer{ *out[worker] };
+            bool ok{ writer.ok() };
+            for (long g = first; g < last && ok; ++g)
+            {
+                std::uint32_t gameSeed{ GameColumns::gameSeed(seed, g) };
+                Random::mt.seed(gameSeed);
+                Hero hero{""};
+                playGame(hero, io);
+                monitor.add(worker, !hero.dead(), hero.gold());
+                ok = columns.store(writer, gameSeed, hero);
+            }
+            monitor.publish(worker);
+            storeOk[worker] &= static_cast<char>(ok);
+        });
+
+        bool stored{true};
+        for (int w = 0; w < runtime.workers(); ++w)
+            if (out[w])
+                stored = out[w]->close() && storeOk[w] && stored;
+        if (!stored)
+        {
+            std::cerr << "Could not write the store " << Columns::segmentPath(store, 0) << '\n';
+            return 1;
+        }
+
+        Convergence::Snapshot result{ monitor.finish() };
+        std::cout << "\nsimulated " << result.stat.n << " games with the best policy: win rate " << std::setprecision(6)
+                  << result.stat.mean << " +- " << result.stat.halfWidth() << " (exact " << bestWin.start << ")\n";
+        if (result.stat.n < static_cast<std::uint64_t>(games))
+            std::cout << "stopped after " << std::setprecision(2) << result.seconds << " s at the target width "
+                      << std::setprecision(6) << target.halfWidth << '\n';
+        std::cout << "gold per game: p10 " << result.histogram.quantile(0.1) << ", median "
+                  << result.histogram.quantile(0.5) << ", p90 " << result.histogram.quantile(0.9) << '\n';
+    }
+    return 0;
+}
+
+// RPG --scaling [max threads] [games]
+// Plays the same seeded games of the cautious policy on 1, 2, 4 ... workers
+int scalingMain(int argc, char* argv[])
+{
+    int maxThreads{ argc > 2 ? std::max(1, std::stoi(argv[2])) : 64 };
+    long games{ argc > 3 ? std::stol(argv[3]) : 2000000 };
+    const std::uint32_t seed{1};
+    const long blocks{ (games + blockGames - 1) / blockGames };
+
+    Jobs::scaling(maxThreads, static_cast<double>(games), "games", [&](Jobs::Runtime& runtime) {
+        Jobs::PerWorker<long> wins{ runtime, 0 };
+        runtime.parallelFor(static_cast<std::size_t>(blocks), [&](std::size_t block, int worker) {
+            std::seed_seq seq{ seed, static_cast<std::uint32_t>(block) };
+            Random::mt.seed(seq);
+            Cautious io;
+            const long first{ static_cast<long>(block) * blockGames };
+            for (long g = first; g < std::min(games, first + blockGames); ++g)
+            {
+                Hero hero{""};
+                playGame(hero, io);
+                wins[worker] += !hero.dead();
+            }
+        });
+        long total{0};
+        wins.forEach([&](long w) { total += w; });
+        return static_cast<double>(total) / static_cast<double>(games);
+    });
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && std::string_view{argv[1]} == "--solve")
+        return solverMain(argc, argv);
+    if (argc > 1 && std::string_view{argv[1]} == "--bench")
+        return benchMain(argc, argv);
+    if (argc > 1 && std::string_view{argv[1]} == "--verify-fights")
+        return verifyMain(argc, argv);
+    if (argc > 1 && std::string_view{argv[1]} == "--scaling")
+        return scalingMain(argc, argv);
+
+    // RPG --trace <file> writes a latency trace of the game
+    std::unique_ptr<Trace::Session> trace;
+    if (argc == 3 && std::string_view{argv[1]} == "--trace")
+        trace = std::make_unique<Trace::Session>(argv[2]);
+
     std::cout << "Enter your hero's name: ";
     std::string name;
-    std::cin >> name;
+    Trace::read("name", name);
 
     Hero hero{name};
     std::cout << "Welcome, " << hero.name() << "!\n";
 
-    while (!hero.dead() && !hero.won())
-        encounter(hero);
+    Console console;
+    playGame(hero, console);
 
     if (hero.dead())
     {
@@ -0,0 +1,194 @@
+// Latency tracing of the interactive games.
+//
+// With a Session open, every answer the game reads through Trace::read()
+// records four events on the calling thread:
+//  - prompt:   the moment the game asks (instant)
+//  - flush:    writing the buffered output and the prompt to the terminal
+//  - input:    waiting for the answer, ending when it has been read
+//  - response: from the previous answer to the end of this flush, i.e.
+//              how long the player waited for the game to reply
+// Timestamps are CLOCK_MONOTONIC_RAW, which NTP does not slew and which is
+// read through the vDSO, so a timestamp costs tens of nanoseconds and
+// needs no TSC calibration.
+//
+// Each thread appends to its own fixed-size buffer: one writer, no locks,
+// and a reader that only sees events published by the size counter. A full
+// buffer drops events and counts them. When the session ends the buffers
+// are written as Chrome trace-event JSON, which chrome://tracing and
+// Perfetto open, one track per thread.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+namespace Trace
+{
+    inline std::uint64_t now()
+    {
+        timespec t{};
+        clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+        return static_cast<std::uint64_t>(t.tv_sec) * 1000000000u + static_cast<std::uint64_t>(t.tv_nsec);
+    }
+
+    struct Event
+    {
+        const char* name;       // a string literal
+        const char* label;      // what was asked, a string literal
+        char phase;             // 'X' for a span, 'i' for an instant
+        std::uint64_t begin;    // ns
+        std::uint64_t end;      // ns
+        std::uint32_t turn;
+    };
+
+    // One thread's events. Only the owner appends; the exporter reads up
+    // to the published size
+    class Buffer
+    {
+        static constexpr std::size_t capacity{ 1 << 16 };
+
+        std::unique_ptr<std::array<Event, capacity>> m_events{ std::make_unique<std::array<Event, capacity>>() };
+        std::atomic<std::size_t> m_size{0};
+        std::atomic<std::uint64_t> m_dropped{0};
+
+    public:
+        const int tid;
+        std::uint32_t turn{0};
+        std::uint64_t lastInput{0};
+
+        explicit Buffer(int id) : tid{id} {}
+
+        void add(const Event& e)
+        {
+            const std::size_t n{ m_size.load(std::memory_order_relaxed) };
+            if (n == capacity)
+            {
+                m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+            (*m_events)[n] = e;
+            m_size.store(n + 1, std::memory_order_release);
+        }
+
+        std::size_t size() const { return m_size.load(std::memory_order_acquire); }
+        const Event& operator[](std::size_t i) const { return (*m_events)[i]; }
+        std::uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    };
+
+    // the buffers of all threads; the lock is only taken when a thread
+    // records its first event and when the session is written
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Buffer>> buffers;
+        std::atomic<bool> enabled{false};
+        std::uint64_t start{0};
+    };
+
+    inline Registry registry;
+
+    inline bool enabled() { return registry.enabled.load(std::memory_order_relaxed); }
+
+    inline Buffer& buffer()
+    {
+        thread_local Buffer* mine{nullptr};
+        if (!mine)
+        {
+            std::lock_guard lock{ registry.mutex };
+            registry.buffers.push_back(std::make_unique<Buffer>(static_cast<int>(registry.buffers.size()) + 1));
+            mine = registry.buffers.back().get();
+        }
+        return *mine;
+    }
+
+    // Prints the prompt written so far and reads an answer into value, as
+    // std::cin >> value does, recording the events above when tracing
+    template <typename T>
+    std::istream& read(const char* label, T& value)
+    {
+        if (!enabled())
+            return std::cin >> value;
+
+        Buffer& b{ buffer() };
+        const std::uint64_t asked{ now() };
+        std::cout.flush();
+        const std::uint64_t flushed{ now() };
+        std::cin >> value;
+        const std::uint64_t answered{ now() };
+
+        b.add(Event{"prompt", label, 'i', asked, asked, b.turn});
+        b.add(Event{"flush", label, 'X', asked, flushed, b.turn});
+        if (b.lastInput != 0)
+            b.add(Event{"response", label, 'X', b.lastInput, flushed, b.turn});
+        b.add(Event{"input", label, 'X', flushed, answered, b.turn});
+        b.lastInput = answered;
+        ++b.turn;
+        return std::cin;
+    }
+
+    // Traces the interactive game while it exists and writes the trace to
+    // the file when it ends. Nothing is recorded without a session
+    class Session
+    {
+        std::string m_path;
+
+        static void write(std::ostream& out, const Event& e, int tid, std::uint64_t start)
+        {
+            out << "{\"name\":\"" << e.name << "\",\"cat\":\"turn\",\"ph\":\"" << e.phase
+                << "\",\"pid\":" << getpid() << ",\"tid\":" << tid << std::fixed << std::setprecision(3)
+                << ",\"ts\":" << static_cast<double>(e.begin - start) / 1000.0;
+            if (e.phase == 'i')
+                out << ",\"s\":\"t\"";
+            else
+                out << ",\"dur\":" << static_cast<double>(e.end - e.begin) / 1000.0;
+            out << ",\"args\":{\"turn\":" << e.turn << ",\"prompt\":\"" << e.label << "\"}}";
+        }
+
+    public:
+        explicit Session(std::string path) : m_path{ std::move(path) }
+        {
+            registry.start = now();
+            registry.enabled.store(true, std::memory_order_relaxed);
+        }
+
+        ~Session()
+        {
+            registry.enabled.store(false, std::memory_order_relaxed);
+            std::ofstream out{ m_path };
+            std::lock_guard lock{ registry.mutex };
+            std::uint64_t events{0};
+            std::uint64_t dropped{0};
+            bool first{true};
+            out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+            for (const auto& b : registry.buffers)
+            {
+                for (std::size_t i = 0; i < b->size(); ++i)
+                {
+                    out << (first ? "" : ",\n");
+                    write(out, (*b)[i], b->tid, registry.start);
+                    first = false;
+                }
+                events += b->size();
+                dropped += b->dropped();
+            }
+            out << "\n]}\n";
+            std::cerr << "trace: " << events << " events written to " << m_path;
+            if (dropped > 0)
+                std::cerr << ", " << dropped << " dropped";
+            std::cerr << (out ? "\n" : " (write failed)\n");
+        }
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+    };
+}
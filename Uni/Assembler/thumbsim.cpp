@@ -0,0 +1,1770 @@
+// Ассемблер и интерпретатор Thumb (Cortex-M0) для лабораторных работ.
+//
+// Сборка: g++ -std=c++17 -O2 thumbsim.cpp -o thumbsim
+// Запуск: thumbsim [--dump] [--profile] [--bench N] [--steps N] файл|каталог ...
+//
+// Понимает подмножество синтаксиса Keil armasm, которое используется в
+// LR_2_*.txt и LR3_*.txt: AREA/ENTRY/ALIGN/EXPORT/END, EQU, DCB/DCW/DCD,
+// метки с первой позиции строки, LDR Rd, =выражение, и инструкции Thumb-1
+// (ARMv6-M) без системных. Файл может содержать несколько программ: все,
+// что идет после END до следующего AREA, пропускается, а строка вида
+// "----- ПРАВИЛЬНОЕ РЕШЕНИЕ -----" становится названием следующей программы.
+//
+// Карта памяти: Flash с 0x08000000 (первой кладется область RESET с
+// таблицей векторов, затем области кода), SRAM 32 КБ с 0x20000000 (области
+// READWRITE кладутся туда уже инициализированными, как их загружает
+// отладчик). SP и точка входа берутся из таблицы векторов.
+//
+// Программа останавливается на переходе на саму себя (STOP B STOP), на
+// ошибке доступа к памяти или по исчерпании лимита шагов. Такты считаются
+// по Cortex-M0 TRM: АЛУ и MULS - 1, LDR/STR - 2, PUSH/POP - 1+N, переход
+// выполненный - 3, невыполненный - 1, BL - 4, BX - 3.
+//
+// Инструкции заранее декодируются в массив Insn (литералы LDR =... уже
+// подставлены, цели переходов - индексы), а интерпретатор с GCC/Clang
+// переходит к обработчику следующей инструкции по адресу метки (computed
+// goto), без общего switch.
+//
+// --profile: для каждой программы выводится плоский профиль по меткам
+// (инструкции относятся к ближайшей метке выше по тексту: сколько раз в нее
+// вошли, сколько выполнено инструкций и тактов) и листинг исходного текста
+// с числом выполнений и тактами каждой строки; у условных переходов
+// отдельно показано, сколько раз переход выполнился. Профилирующий вариант
+// интерпретатора - отдельная специализация шаблона, так что обычный прогон
+// счетчиками не замедляется.
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// -DTHUMBSIM_THREADED=0 - обычный switch вместо computed goto
+#ifndef THUMBSIM_THREADED
+#if defined(__GNUC__)
+#define THUMBSIM_THREADED 1
+#else
+#define THUMBSIM_THREADED 0
+#endif
+#endif
+
+namespace Mem
+{
+    constexpr std::uint32_t flashBase{ 0x08000000 };
+    constexpr std::uint32_t flashSize{ 64 * 1024 };
+    constexpr std::uint32_t sramBase{ 0x20000000 };
+    constexpr std::uint32_t sramSize{ 32 * 1024 };
+}
+
+// Декодированная инструкция
+enum class Op : std::uint8_t
+{
+    movsImm, movReg, movsReg, mvns,
+    addsImm, addsReg, addReg, addSpImm, addRdSp, subsImm, subsReg, subSpImm,
+    adcs, sbcs, rsbs, cmpImm, cmpReg, cmn,
+    ands, orrs, eors, bics, tst, muls,
+    lslsImm, lsrsImm, asrsImm, lslsReg, lsrsReg, asrsReg, rors,
+    rev, rev16, revsh, sxtb, sxth, uxtb, uxth,
+    ldrLit,
+    ldrImm, ldrReg, ldrhImm, ldrhReg, ldrbImm, ldrbReg, ldrshReg, ldrsbReg,
+    strImm, strReg, strhImm, strhReg, strbImm, strbReg,
+    push, pop,
+    b, bcond, bl, bx,
+    nop, halt, fault,
+    maxOps
+};
+
+enum class Cond : std::uint8_t { eq, ne, cs, cc, mi, pl, vs, vc, hi, ls, ge, lt, gt, le, al };
+
+struct Insn
+{
+    Op op{Op::nop};
+    std::uint8_t rd{}, rn{}, rm{};
+    Cond cond{Cond::al};
+    std::uint32_t imm{};      // непосредственное значение, литерал, маска регистров
+    std::uint32_t target{};   // индекс инструкции - цель перехода
+    std::uint32_t addr{};     // адрес во Flash
+    int line{};               // строка исходного файла
+    const void* handler{};    // обработчик (заполняет интерпретатор)
+};
+
+// Собранная программа
+struct Program
+{
+    std::string name;         // файл#номер
+    std::string title;        // строка-разделитель перед программой
+    std::string error;        // ошибка сборки (пусто - собрана)
+    std::vector<Insn> code;   // последний элемент - Op::fault "вне кода"
+    std::vector<std::uint8_t> flash;
+    std::vector<std::uint8_t> sram;
+    std::uint32_t entry{};    // индекс первой инструкции
+    std::uint32_t sp{ Mem::sramBase + Mem::sramSize };
+    std::vector<std::string> source;            // строки исходного текста
+    std::map<std::uint32_t, std::string> labels; // адрес -> метка (для отчетов)
+
+    // Индекс инструкции по адресу во Flash (или -1)
+    std::vector<std::int32_t> addrToIndex;
+};
+
+namespace Asm
+{
+    std::string upper(std::string s)
+    {
+        for (auto& ch : s)
+            ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+        return s;
+    }
+
+    std::string trim(std::string_view s)
+    {
+        std::size_t b{0}, e{s.size()};
+        while (b < e && std::isspace(static_cast<unsigned char>(s[b])))
+            ++b;
+        while (e > b && std::isspace(static_cast<unsigned char>(s[e - 1])))
+            --e;
+        return std::string{s.substr(b, e - b)};
+    }
+
+    // Деление операндов по запятым вне [] и {}
+    std::vector<std::string> splitOperands(const std::string& s)
+    {
+        std::vector<std::string> out;
+        int depth{0};
+        std::string cur;
+        for (char ch : s)
+        {
+            if (ch == '[' || ch == '{')
+                ++depth;
+            else if (ch == ']' || ch == '}')
+                --depth;
+            if (ch == ',' && depth == 0)
+            {
+                out.push_back(trim(cur));
+                cur.clear();
+            }
+            else
+                cur += ch;
+        }
+        if (!trim(cur).empty() || !out.empty())
+            out.push_back(trim(cur));
+        return out;
+    }
+
+    std::optional<int> parseReg(const std::string& s)
+    {
+        std::string u{ upper(trim(s)) };
+        if (u == "SP") return 13;
+        if (u == "LR") return 14;
+        if (u == "PC") return 15;
+        if (u.size() >= 2 && u.size() <= 3 && u[0] == 'R' && std::isdigit(static_cast<unsigned char>(u[1])))
+        {
+            int n{ std::stoi(u.substr(1)) };
+            if (n <= 15 && (u.size() == 2 || std::isdigit(static_cast<unsigned char>(u[2]))))
+                return n;
+        }
+        return std::nullopt;
+    }
+
+    bool isLow(int r) { return r >= 0 && r <= 7; }
+
+    struct Symbols
+    {
+        std::map<std::string, std::uint32_t> values;
+    };
+
+    // Значение выражения: числа (0x.., десятичные, 2_..), символы и + -
+    std::optional<std::uint32_t> eval(const std::string& text, const Symbols& syms)
+    {
+        std::string s{ trim(text) };
+        if (s.empty())
+            return std::nullopt;
+
+        std::uint32_t result{0};
+        std::size_t i{0};
+        int sign{1};
+        bool haveTerm{false};
+        while (i < s.size())
+        {
+            char ch{ s[i] };
+            if (std::isspace(static_cast<unsigned char>(ch)))
+            {
+                ++i;
+                continue;
+            }
+            if (ch == '+' || ch == '-')
+            {
+                sign = (ch == '-') ? -sign : sign;
+                ++i;
+                continue;
+            }
+
+            std::size_t j{i};
+            while (j < s.size() && (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '_'))
+                ++j;
+            std::string tok{ s.substr(i, j - i) };
+            if (tok.empty())
+                return std::nullopt;
+
+            std::uint32_t v{};
+            if (std::isdigit(static_cast<unsigned char>(tok[0])))
+            {
+                try
+                {
+                    std::size_t used{};
+                    if (tok.size() > 2 && tok[0] == '0' && (tok[1] == 'x' || tok[1] == 'X'))
+                        v = static_cast<std::uint32_t>(std::stoull(tok.substr(2), &used, 16)), used += 2;
+                    else if (tok.size() > 2 && tok[0] == '2' && tok[1] == '_')
+                        v = static_cast<std::uint32_t>(std::stoull(tok.substr(2), &used, 2)), used += 2;
+                    else
+                        v = static_cast<std::uint32_t>(std::stoull(tok, &used, 10));
+                    if (used != tok.size())
+                        return std::nullopt;
+                }
+                catch (const std::exception&)
+                {
+                    return std::nullopt;
+                }
+            }
+            else
+            {
+                auto it{ syms.values.find(tok) };
+                if (it == syms.values.end())
+                    return std::nullopt;
+                v = it->second;
+            }
+
+            result += (sign < 0) ? (0u - v) : v;
+            sign = 1;
+            haveTerm = true;
+            i = j;
+        }
+
+        if (!haveTerm)
+            return std::nullopt;
+        return result;
+    }
+
+    // Строка исходного текста после разбора
+    struct Line
+    {
+        int number{};
+        std::string label;
+        std::string mnemonic;  // в верхнем регистре
+        std::string operands;
+    };
+
+    struct Area
+    {
+        std::string name;
+        bool code{false};
+        bool readWrite{false};
+        std::uint32_t size{0};
+        std::uint32_t base{0};
+    };
+
+    // Элемент программы после первого прохода
+    struct Item
+    {
+        Line line;
+        std::size_t area{};
+        std::uint32_t offset{};
+    };
+
+    const std::array directives{
+        std::string_view{"AREA"}, std::string_view{"ENTRY"}, std::string_view{"ALIGN"},
+        std::string_view{"EXPORT"}, std::string_view{"IMPORT"}, std::string_view{"END"},
+        std::string_view{"PRESERVE8"}, std::string_view{"THUMB"}, std::string_view{"LTORG"}
+    };
+
+    bool isDirective(const std::string& u)
+    {
+        return std::find(directives.begin(), directives.end(), u) != directives.end();
+    }
+
+    // Разбор одной строки: метка с первой позиции, мнемоника, операнды
+    Line splitLine(const std::string& raw, int number)
+    {
+        Line l;
+        l.number = number;
+
+        std::string s{raw};
+        bool inQuote{false};
+        for (std::size_t i = 0; i < s.size(); ++i)
+        {
+            if (s[i] == '"')
+                inQuote = !inQuote;
+            if (s[i] == ';' && !inQuote)
+            {
+                s.resize(i);
+                break;
+            }
+        }
+
+        std::istringstream in{s};
+        std::string first;
+        if (!(in >> first))
+            return l;
+
+        bool column0{ !s.empty() && !std::isspace(static_cast<unsigned char>(s[0])) };
+        if (column0 && !isDirective(upper(first)))
+        {
+            l.label = first;
+            if (!(in >> l.mnemonic))
+                return l;
+        }
+        else
+            l.mnemonic = first;
+
+        l.mnemonic = upper(l.mnemonic);
+        std::string rest;
+        std::getline(in, rest);
+        l.operands = trim(rest);
+        return l;
+    }
+
+    // Размер инструкции или данных в байтах
+    std::uint32_t itemSize(const Line& l, const Symbols& syms, std::string& error)
+    {
+        const std::string& m{ l.mnemonic };
+        if (m == "DCD" || m == "DCDU")
+            return 4 * static_cast<std::uint32_t>(splitOperands(l.operands).size());
+        if (m == "DCW" || m == "DCWU")
+            return 2 * static_cast<std::uint32_t>(splitOperands(l.operands).size());
+        if (m == "DCB")
+        {
+            std::uint32_t n{0};
+            for (const auto& op : splitOperands(l.operands))
+                n += (op.size() >= 2 && op.front() == '"') ? static_cast<std::uint32_t>(op.size() - 2) : 1;
+            return n;
+        }
+        if (m == "SPACE" || m == "FILL")
+        {
+            auto v{ eval(l.operands, syms) };
+            if (!v)
+                error = "неверный размер SPACE";
+            return v.value_or(0);
+        }
+        if (m == "BL")
+            return 4;
+        return 2;
+    }
+
+    class Assembler
+    {
+        Program& m_prog;
+        Symbols m_syms;
+        std::vector<Area> m_areas;
+        std::vector<Item> m_items;
+        bool m_haveVectors{false};
+        std::uint32_t m_vectorSp{}, m_vectorEntry{};
+
+        bool fail(int line, const std::string& msg)
+        {
+            if (m_prog.error.empty())
+                m_prog.error = "строка " + std::to_string(line) + ": " + msg;
+            return false;
+        }
+
+    public:
+        explicit Assembler(Program& p) : m_prog{p} {}
+
+        // Первый проход: области, адреса меток, EQU
+        bool layout(const std::vector<Line>& lines)
+        {
+            std::size_t area{ static_cast<std::size_t>(-1) };
+            std::map<std::string, std::pair<std::size_t, std::uint32_t>> labelPos;
+
+            for (const Line& l : lines)
+            {
+                const std::string& m{ l.mnemonic };
+                if (m == "AREA")
+                {
+                    auto ops{ splitOperands(l.operands) };
+                    Area a;
+                    a.name = ops.empty() ? "" : ops[0];
+                    for (std::size_t i = 1; i < ops.size(); ++i)
+                    {
+                        std::string u{ upper(ops[i]) };
+                        if (u == "CODE") a.code = true;
+                        if (u == "READWRITE") a.readWrite = true;
+                    }
+                    m_areas.push_back(a);
+                    area = m_areas.size() - 1;
+                    if (!l.label.empty())
+                        return fail(l.number, "метка перед AREA");
+                    continue;
+                }
+                if (m == "EQU")
+                {
+                    auto v{ eval(l.operands, m_syms) };
+                    if (!v || l.label.empty())
+                        return fail(l.number, "неверный EQU");
+                    m_syms.values[l.label] = *v;
+                    continue;
+                }
+
+                if (!l.label.empty())
+                {
+                    if (area == static_cast<std::size_t>(-1))
+                        return fail(l.number, "метка вне AREA");
+                    if (labelPos.count(l.label))
+                        return fail(l.number, "повторная метка " + l.label);
+                    labelPos[l.label] = { area, m_areas[area].size };
+                }
+
+                if (m.empty() || m == "ENTRY" || m == "EXPORT" || m == "IMPORT" || m == "PRESERVE8"
+                    || m == "THUMB" || m == "LTORG" || m == "END")
+                    continue;
+
+                if (area == static_cast<std::size_t>(-1))
+                    return fail(l.number, "инструкция вне AREA");
+
+                if (m == "ALIGN")
+                {
+                    std::uint32_t align{4};
+                    if (!l.operands.empty())
+                        align = eval(l.operands, m_syms).value_or(4);
+                    if (align == 0 || (align & (align - 1)))
+                        return fail(l.number, "неверное выравнивание");
+                    m_areas[area].size = (m_areas[area].size + align - 1) & ~(align - 1);
+                    continue;
+                }
+
+                std::string err;
+                std::uint32_t size{ itemSize(l, m_syms, err) };
+                if (!err.empty())
+                    return fail(l.number, err);
+
+                // Инструкции Thumb выравниваются на 2 байта
+                if (m_areas[area].code && size >= 2 && m != "DCB")
+                    m_areas[area].size = (m_areas[area].size + 1) & ~1u;
+
+                m_items.push_back({ l, area, m_areas[area].size });
+                m_areas[area].size += size;
+            }
+
+            // Размещение областей: RESET первой во Flash, затем остальные
+            // только для чтения, READWRITE - в SRAM
+            std::uint32_t flashAt{ Mem::flashBase }, sramAt{ Mem::sramBase };
+            auto place = [&](Area& a) {
+                std::uint32_t& at{ a.readWrite ? sramAt : flashAt };
+                at = (at + 3) & ~3u;
+                a.base = at;
+                at += a.size;
+            };
+            for (auto& a : m_areas)
+                if (upper(a.name) == "RESET" && !a.readWrite)
+                    place(a);
+            for (auto& a : m_areas)
+                if (upper(a.name) != "RESET" || a.readWrite)
+                    place(a);
+
+            if (flashAt > Mem::flashBase + Mem::flashSize || sramAt > Mem::sramBase + Mem::sramSize)
+                return fail(lines.empty() ? 0 : lines.back().number, "программа не помещается в память");
+
+            // Адреса меток. Метки кода получают адрес без бита Thumb; он
+            // добавляется только в DCD (таблица векторов)
+            for (const auto& [name, pos] : labelPos)
+            {
+                std::uint32_t addr{ m_areas[pos.first].base + pos.second };
+                m_syms.values[name] = addr;
+                m_prog.labels[addr] = m_prog.labels.count(addr) ? m_prog.labels[addr] + "/" + name : name;
+            }
+
+            return true;
+        }
+
+        // Второй проход: данные и декодирование инструкций
+        bool emit()
+        {
+            m_prog.flash.assign(Mem::flashSize, 0);
+            m_prog.sram.assign(Mem::sramSize, 0);
+            m_prog.addrToIndex.assign(Mem::flashSize / 2, -1);
+
+            for (const Item& it : m_items)
+            {
+                const Area& a{ m_areas[it.area] };
+                std::uint32_t addr{ a.base + it.offset };
+                const Line& l{ it.line };
+
+                if (l.mnemonic == "DCB" || l.mnemonic == "DCW" || l.mnemonic == "DCWU"
+                    || l.mnemonic == "DCD" || l.mnemonic == "DCDU" || l.mnemonic == "SPACE" || l.mnemonic == "FILL")
+                {
+                    if (!emitData(l, addr, a))
+                        return false;
+                    continue;
+                }
+
+                if (a.readWrite)
+                    return fail(l.number, "инструкция в области данных");
+
+                Insn insn;
+                insn.addr = addr;
+                insn.line = l.number;
+                if (!decode(l, insn))
+                    return false;
+
+                m_prog.addrToIndex[(addr - Mem::flashBase) / 2] = static_cast<std::int32_t>(m_prog.code.size());
+                m_prog.code.push_back(insn);
+            }
+
+            // Страж за последней инструкцией: выполнение "вне кода"
+            Insn end;
+            end.op = Op::fault;
+            end.addr = 0xFFFFFFFF;
+            m_prog.code.push_back(end);
+
+            // Цели переходов: адреса -> индексы
+            for (auto& insn : m_prog.code)
+            {
+                if (insn.op == Op::b || insn.op == Op::bcond || insn.op == Op::bl)
+                {
+                    std::int32_t idx{ indexOf(insn.target) };
+                    if (idx < 0)
+                        return fail(insn.line, "переход не на инструкцию");
+                    insn.target = static_cast<std::uint32_t>(idx);
+
+                    // Переход на самого себя - конец программы
+                    if (insn.op == Op::b && &m_prog.code[insn.target] == &insn)
+                        insn.op = Op::halt;
+                }
+            }
+
+            // Точка входа и SP: из таблицы векторов, иначе Reset_Handler или
+            // начало кода
+            std::optional<std::uint32_t> entryAddr;
+            if (m_haveVectors)
+            {
+                m_prog.sp = m_vectorSp;
+                entryAddr = m_vectorEntry & ~1u;
+            }
+            else if (m_syms.values.count("Reset_Handler"))
+                entryAddr = m_syms.values["Reset_Handler"];
+
+            if (entryAddr)
+            {
+                std::int32_t idx{ indexOf(*entryAddr) };
+                if (idx < 0)
+                    return fail(0, "точка входа не указывает на инструкцию");
+                m_prog.entry = static_cast<std::uint32_t>(idx);
+            }
+            return true;
+        }
+
+        std::int32_t indexOf(std::uint32_t addr) const
+        {
+            if (addr < Mem::flashBase || addr >= Mem::flashBase + Mem::flashSize || (addr & 1))
+                return -1;
+            return m_prog.addrToIndex[(addr - Mem::flashBase) / 2];
+        }
+
+    private:
+        bool emitData(const Line& l, std::uint32_t addr, const Area& a)
+        {
+            std::vector<std::uint8_t>& mem{ a.readWrite ? m_prog.sram : m_prog.flash };
+            std::uint32_t at{ addr - (a.readWrite ? Mem::sramBase : Mem::flashBase) };
+
+            if (l.mnemonic == "SPACE" || l.mnemonic == "FILL")
+                return true;
+
+            auto ops{ splitOperands(l.operands) };
+            std::uint32_t width{ l.mnemonic == "DCB" ? 1u : (l.mnemonic[2] == 'W' ? 2u : 4u) };
+            // Таблица векторов может занимать несколько строк DCD: SP - слово
+            // по смещению 0 области RESET, точка входа - по смещению 4
+            bool vectors{ upper(a.name) == "RESET" && !a.readWrite && width == 4 };
+
+            for (std::size_t i = 0; i < ops.size(); ++i)
+            {
+                const std::string& op{ ops[i] };
+                if (width == 1 && op.size() >= 2 && op.front() == '"')
+                {
+                    for (std::size_t k = 1; k + 1 < op.size(); ++k)
+                        mem[at++] = static_cast<std::uint8_t>(op[k]);
+                    continue;
+                }
+
+                auto v{ eval(op, m_syms) };
+                if (!v)
+                    return fail(l.number, "неизвестное значение " + op);
+
+                std::uint32_t value{ *v };
+                // Адреса кода в DCD получают бит Thumb, как у armasm
+                if (width == 4 && m_syms.values.count(trim(op)) && indexOfLabel(trim(op)))
+                    value |= 1;
+
+                for (std::uint32_t k = 0; k < width; ++k)
+                    mem[at++] = static_cast<std::uint8_t>(value >> (8 * k));
+
+                std::uint32_t offset{ addr - a.base + 4 * static_cast<std::uint32_t>(i) };
+                if (vectors && offset == 0)
+                    m_vectorSp = value;
+                if (vectors && offset == 4)
+                {
+                    m_vectorEntry = value;
+                    m_haveVectors = true;
+                }
+            }
+            return true;
+        }
+
+        // Метка указывает в область кода
+        bool indexOfLabel(const std::string& name) const
+        {
+            std::uint32_t addr{ m_syms.values.at(name) };
+            for (const auto& a : m_areas)
+                if (a.code && addr >= a.base && addr < a.base + a.size)
+                    return true;
+            return false;
+        }
+
+        std::optional<std::uint32_t> immediate(const std::string& op) const
+        {
+            std::string s{ trim(op) };
+            if (!s.empty() && s[0] == '#')
+                s = s.substr(1);
+            return eval(s, m_syms);
+        }
+
+        static bool isImmediate(const std::string& op)
+        {
+            std::string s{ trim(op) };
+            return !s.empty() && (s[0] == '#' || std::isdigit(static_cast<unsigned char>(s[0])) || s[0] == '-');
+        }
+
+        // Операнд памяти [Rn], [Rn, #imm], [Rn, Rm]
+        bool memOperand(const Line& l, const std::string& op, int& rn, int& rm, std::uint32_t& imm, bool& regOffset)
+        {
+            std::string s{ trim(op) };
+            if (s.size() < 3 || s.front() != '[' || s.back() != ']')
+                return fail(l.number, "ожидался операнд памяти [Rn, ...]");
+            auto parts{ splitOperands(s.substr(1, s.size() - 2)) };
+            auto base{ parseReg(parts.empty() ? "" : parts[0]) };
+            if (!base)
+                return fail(l.number, "неверный базовый регистр");
+            rn = *base;
+            regOffset = false;
+            imm = 0;
+            if (parts.size() == 2)
+            {
+                if (auto r{ parseReg(parts[1]) })
+                {
+                    rm = *r;
+                    regOffset = true;
+                }
+                else if (auto v{ immediate(parts[1]) })
+                    imm = *v;
+                else
+                    return fail(l.number, "неверное смещение " + parts[1]);
+            }
+            else if (parts.size() > 2)
+                return fail(l.number, "неверный операнд памяти");
+            return true;
+        }
+
+        bool needLow(const Line& l, std::initializer_list<int> regs)
+        {
+            for (int r : regs)
+                if (!isLow(r))
+                    return fail(l.number, "в Thumb-1 здесь допустимы только R0-R7");
+            return true;
+        }
+
+        bool decode(const Line& l, Insn& insn);
+    };
+
+    bool Assembler::decode(const Line& l, Insn& insn)
+    {
+        std::string m{ l.mnemonic };
+        auto ops{ splitOperands(l.operands) };
+        auto reg = [&](std::size_t i) -> std::optional<int> {
+            return i < ops.size() ? parseReg(ops[i]) : std::nullopt;
+        };
+
+        // Переходы
+        static const std::map<std::string, Cond> conds{
+            {"EQ", Cond::eq}, {"NE", Cond::ne}, {"CS", Cond::cs}, {"HS", Cond::cs}, {"CC", Cond::cc},
+            {"LO", Cond::cc}, {"MI", Cond::mi}, {"PL", Cond::pl}, {"VS", Cond::vs}, {"VC", Cond::vc},
+            {"HI", Cond::hi}, {"LS", Cond::ls}, {"GE", Cond::ge}, {"LT", Cond::lt}, {"GT", Cond::gt},
+            {"LE", Cond::le}, {"AL", Cond::al}
+        };
+        if (m == "B" || m == "BL" || (m.size() == 3 && m[0] == 'B' && conds.count(m.substr(1))))
+        {
+            if (ops.size() != 1)
+                return fail(l.number, "переход требует одну метку");
+            auto v{ eval(ops[0], m_syms) };
+            if (!v)
+                return fail(l.number, "неизвестная метка " + ops[0]);
+            insn.target = *v;
+            if (m == "BL")
+                insn.op = Op::bl;
+            else if (m == "B" || m == "BAL")
+                insn.op = Op::b;
+            else
+            {
+                insn.op = Op::bcond;
+                insn.cond = conds.at(m.substr(1));
+            }
+            return true;
+        }
+        if (m == "BX")
+        {
+            auto r{ reg(0) };
+            if (!r || ops.size() != 1)
+                return fail(l.number, "BX требует регистр");
+            insn.op = Op::bx;
+            insn.rm = static_cast<std::uint8_t>(*r);
+            return true;
+        }
+        if (m == "NOP")
+        {
+            insn.op = Op::nop;
+            return true;
+        }
+
+        // PUSH/POP {список}
+        if (m == "PUSH" || m == "POP")
+        {
+            std::string s{ trim(l.operands) };
+            if (s.size() < 2 || s.front() != '{' || s.back() != '}')
+                return fail(l.number, "ожидался список регистров {...}");
+            std::uint32_t mask{0};
+            for (const auto& part : splitOperands(s.substr(1, s.size() - 2)))
+            {
+                auto dash{ part.find('-') };
+                auto lo{ parseReg(part.substr(0, dash)) };
+                auto hi{ dash == std::string::npos ? lo : parseReg(part.substr(dash + 1)) };
+                if (!lo || !hi || *hi < *lo)
+                    return fail(l.number, "неверный список регистров");
+                for (int r = *lo; r <= *hi; ++r)
+                    mask |= 1u << r;
+            }
+            std::uint32_t allowed{ 0xFFu | (m == "PUSH" ? (1u << 14) : (1u << 15)) };
+            if (mask == 0 || (mask & ~allowed))
+                return fail(l.number, "недопустимый регистр в " + m);
+            insn.op = (m == "PUSH") ? Op::push : Op::pop;
+            insn.imm = mask;
+            return true;
+        }
+
+        // Загрузка и сохранение
+        static const std::map<std::string, std::pair<Op, Op>> memOps{
+            {"LDR", {Op::ldrImm, Op::ldrReg}}, {"LDRH", {Op::ldrhImm, Op::ldrhReg}},
+            {"LDRB", {Op::ldrbImm, Op::ldrbReg}}, {"LDRSH", {Op::fault, Op::ldrshReg}},
+            {"LDRSB", {Op::fault, Op::ldrsbReg}}, {"STR", {Op::strImm, Op::strReg}},
+            {"STRH", {Op::strhImm, Op::strhReg}}, {"STRB", {Op::strbImm, Op::strbReg}}
+        };
+        if (auto it{ memOps.find(m) }; it != memOps.end())
+        {
+            auto rd{ reg(0) };
+            if (!rd || ops.size() != 2)
+                return fail(l.number, m + " требует регистр и адрес");
+            insn.rd = static_cast<std::uint8_t>(*rd);
+
+            // LDR Rd, =выражение - литерал из пула, значение известно сразу
+            if (m == "LDR" && !ops[1].empty() && ops[1][0] == '=')
+            {
+                auto v{ eval(ops[1].substr(1), m_syms) };
+                if (!v)
+                    return fail(l.number, "неизвестное значение " + ops[1]);
+                if (!needLow(l, {*rd}))
+                    return false;
+                insn.op = Op::ldrLit;
+                insn.imm = *v;
+                return true;
+            }
+
+            int rn{}, rm{};
+            std::uint32_t imm{};
+            bool regOffset{};
+            if (!memOperand(l, ops[1], rn, rm, imm, regOffset))
+                return false;
+
+            std::uint32_t width{ (m == "LDR" || m == "STR") ? 4u : ((m.back() == 'H') ? 2u : 1u) };
+            insn.rn = static_cast<std::uint8_t>(rn);
+            insn.rm = static_cast<std::uint8_t>(rm);
+            insn.imm = imm;
+
+            if (regOffset)
+            {
+                insn.op = it->second.second;
+                return needLow(l, {*rd, rn, rm});
+            }
+
+            if (it->second.first == Op::fault)
+                return fail(l.number, m + " поддерживает только адресацию [Rn, Rm]");
+            if (!needLow(l, {*rd, rn}))
+                return false;
+            if (imm % width != 0 || imm / width > 31)
+                return fail(l.number, "смещение вне диапазона #0-" + std::to_string(31 * width) + " с шагом " + std::to_string(width));
+            insn.op = it->second.first;
+            return true;
+        }
+
+        // Арифметика и логика
+        auto rd{ reg(0) };
+        if (!rd)
+            return fail(l.number, "неизвестная инструкция или неверный операнд: " + m + " " + l.operands);
+        insn.rd = static_cast<std::uint8_t>(*rd);
+
+        if (m == "MOV" || m == "MOVS")
+        {
+            if (ops.size() != 2)
+                return fail(l.number, m + " требует два операнда");
+            if (auto rm{ reg(1) })
+            {
+                insn.rm = static_cast<std::uint8_t>(*rm);
+                if (*rd == 15)
+                    return fail(l.number, "запись в PC через MOV не поддерживается");
+                insn.op = (m == "MOVS") ? Op::movsReg : Op::movReg;
+                return m == "MOV" || needLow(l, {*rd, *rm});
+            }
+            auto v{ immediate(ops[1]) };
+            if (!v || *v > 255)
+                return fail(l.number, "непосредственное значение MOVS должно быть 0-255");
+            insn.op = Op::movsImm;
+            insn.imm = *v;
+            return needLow(l, {*rd});
+        }
+
+        if (m == "ADD" || m == "ADDS" || m == "SUB" || m == "SUBS")
+        {
+            bool add{ m[0] == 'A' };
+            bool flags{ m.back() == 'S' };
+
+            // ADD/SUB SP, SP, #imm и ADD Rd, SP, #imm
+            if (!flags)
+            {
+                if (*rd == 13 && ops.size() >= 2 && isImmediate(ops.back()))
+                {
+                    auto v{ immediate(ops.back()) };
+                    if (!v || *v % 4 || *v > 508)
+                        return fail(l.number, "смещение SP должно быть 0-508 с шагом 4");
+                    insn.op = add ? Op::addSpImm : Op::subSpImm;
+                    insn.imm = *v;
+                    return true;
+                }
+                if (add && ops.size() == 3 && reg(1) == 13 && isImmediate(ops[2]))
+                {
+                    auto v{ immediate(ops[2]) };
+                    if (!v || *v % 4 || *v > 1020)
+                        return fail(l.number, "смещение должно быть 0-1020 с шагом 4");
+                    insn.op = Op::addRdSp;
+                    insn.imm = *v;
+                    return needLow(l, {*rd});
+                }
+                if (add && ops.size() == 2 && reg(1) && *rd != 15)
+                {
+                    // ADD Rd, Rm - старшие регистры, флаги не меняются
+                    insn.op = Op::addReg;
+                    insn.rm = static_cast<std::uint8_t>(*reg(1));
+                    return true;
+                }
+                return fail(l.number, "в Thumb-1 нужна форма с суффиксом S: " + m + "S");
+            }
+
+            if (ops.size() == 2)
+                ops.insert(ops.begin(), ops[0]);
+            if (ops.size() != 3)
+                return fail(l.number, m + " требует два или три операнда");
+            auto rn{ reg(1) };
+            if (!rn)
+                return fail(l.number, "неверный регистр " + ops[1]);
+            insn.rn = static_cast<std::uint8_t>(*rn);
+
+            if (auto rm{ reg(2) })
+            {
+                insn.rm = static_cast<std::uint8_t>(*rm);
+                insn.op = add ? Op::addsReg : Op::subsReg;
+                return needLow(l, {*rd, *rn, *rm});
+            }
+            auto v{ immediate(ops[2]) };
+            if (!v)
+                return fail(l.number, "неверное значение " + ops[2]);
+            std::uint32_t limit{ (*rd == *rn) ? 255u : 7u };
+            if (*v > limit)
+                return fail(l.number, "непосредственное значение вне диапазона 0-" + std::to_string(limit));
+            insn.op = add ? Op::addsImm : Op::subsImm;
+            insn.imm = *v;
+            return needLow(l, {*rd, *rn});
+        }
+
+        if (m == "CMP" || m == "CMN")
+        {
+            if (ops.size() != 2)
+                return fail(l.number, m + " требует два операнда");
+            insn.rn = insn.rd;
+            if (auto rm{ reg(1) })
+            {
+                insn.rm = static_cast<std::uint8_t>(*rm);
+                insn.op = (m == "CMP") ? Op::cmpReg : Op::cmn;
+                return m == "CMP" || needLow(l, {*rd, *rm});
+            }
+            if (m == "CMN")
+                return fail(l.number, "CMN требует регистр");
+            auto v{ immediate(ops[1]) };
+            if (!v || *v > 255)
+                return fail(l.number, "непосредственное значение CMP должно быть 0-255");
+            insn.op = Op::cmpImm;
+            insn.imm = *v;
+            return needLow(l, {*rd});
+        }
+
+        // Сдвиги: LSLS Rd, Rm, #imm / LSLS Rd, #imm / LSLS Rd, Rs
+        if (m == "LSLS" || m == "LSRS" || m == "ASRS" || m == "RORS")
+        {
+            if (ops.size() == 2)
+                ops.insert(ops.begin(), ops[0]);
+            if (ops.size() != 3)
+                return fail(l.number, m + " требует два или три операнда");
+            auto rm{ reg(1) };
+            if (!rm)
+                return fail(l.number, "неверный регистр " + ops[1]);
+            insn.rm = static_cast<std::uint8_t>(*rm);
+            if (auto rs{ reg(2) })
+            {
+                if (*rd != *rm)
+                    return fail(l.number, "сдвиг на регистр: Rd и Rn должны совпадать");
+                insn.rn = static_cast<std::uint8_t>(*rs);
+                insn.op = (m == "LSLS") ? Op::lslsReg : (m == "LSRS") ? Op::lsrsReg : (m == "ASRS") ? Op::asrsReg : Op::rors;
+                return needLow(l, {*rd, *rs});
+            }
+            if (m == "RORS")
+                return fail(l.number, "RORS требует регистр");
+            auto v{ immediate(ops[2]) };
+            std::uint32_t max{ (m == "LSLS") ? 31u : 32u };
+            if (!v || *v > max || (m != "LSLS" && *v == 0))
+                return fail(l.number, "сдвиг вне диапазона");
+            insn.imm = *v;
+            insn.op = (m == "LSLS") ? Op::lslsImm : (m == "LSRS") ? Op::lsrsImm : Op::asrsImm;
+            return needLow(l, {*rd, *rm});
+        }
+
+        // RSBS Rd, Rn, #0 и NEGS Rd, Rn
+        if (m == "RSBS" || m == "NEGS")
+        {
+            if ((m == "RSBS" && ops.size() != 3) || (m == "NEGS" && ops.size() != 2))
+                return fail(l.number, m + ": неверное число операндов");
+            auto rn{ reg(1) };
+            if (!rn)
+                return fail(l.number, "неверный регистр " + ops[1]);
+            if (m == "RSBS" && immediate(ops[2]) != 0u)
+                return fail(l.number, "RSBS поддерживает только #0");
+            insn.rn = static_cast<std::uint8_t>(*rn);
+            insn.op = Op::rsbs;
+            return needLow(l, {*rd, *rn});
+        }
+
+        // Двухоперандные операции над младшими регистрами. Форма с тремя
+        // операндами допустима, если Rd совпадает с одним из источников
+        static const std::map<std::string, Op> twoOps{
+            {"ANDS", Op::ands}, {"ORRS", Op::orrs}, {"EORS", Op::eors}, {"BICS", Op::bics},
+            {"ADCS", Op::adcs}, {"SBCS", Op::sbcs}, {"MVNS", Op::mvns}, {"TST", Op::tst},
+            {"MULS", Op::muls}, {"REV", Op::rev}, {"REV16", Op::rev16}, {"REVSH", Op::revsh},
+            {"SXTB", Op::sxtb}, {"SXTH", Op::sxth}, {"UXTB", Op::uxtb}, {"UXTH", Op::uxth}
+        };
+        if (auto it{ twoOps.find(m) }; it != twoOps.end())
+        {
+            insn.op = it->second;
+            bool unary{ m == "MVNS" || m.rfind("REV", 0) == 0 || m.find("XT") == 1 };
+            if (ops.size() == 3 && !unary)
+            {
+                auto a{ reg(1) }, b{ reg(2) };
+                if (!a || !b)
+                    return fail(l.number, "неверный регистр");
+                // Коммутативные операции: Rd может совпадать с любым источником
+                bool commutative{ m == "ANDS" || m == "ORRS" || m == "EORS" || m == "MULS" || m == "ADCS" };
+                if (*a == *rd)
+                    insn.rm = static_cast<std::uint8_t>(*b);
+                else if (*b == *rd && commutative)
+                    insn.rm = static_cast<std::uint8_t>(*a);
+                else
+                    return fail(l.number, m + ": Rd должен совпадать с первым операндом");
+                return needLow(l, {*rd, *a, *b});
+            }
+            if (ops.size() != 2)
+                return fail(l.number, m + " требует два операнда");
+            auto rm{ reg(1) };
+            if (!rm)
+                return fail(l.number, "неверный регистр " + ops[1]);
+            insn.rm = static_cast<std::uint8_t>(*rm);
+            return needLow(l, {*rd, *rm});
+        }
+
+        return fail(l.number, "неизвестная инструкция " + m);
+    }
+
+    // Чтение файла и разбиение на программы (каждая заканчивается END)
+    std::vector<Program> assembleFile(const std::filesystem::path& path)
+    {
+        std::ifstream in{ path, std::ios::binary };
+        std::string text{ std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{} };
+        if (text.rfind("\xEF\xBB\xBF", 0) == 0)
+            text.erase(0, 3);
+
+        std::vector<std::string> source;
+        {
+            std::istringstream ss{text};
+            std::string line;
+            while (std::getline(ss, line))
+            {
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                source.push_back(line);
+            }
+        }
+
+        std::vector<Program> programs;
+        std::vector<Line> current;
+        std::string title;
+        bool inside{false};
+
+        auto finish = [&]() {
+            Program p;
+            p.name = path.filename().string() + "#" + std::to_string(programs.size() + 1);
+            p.title = title;
+            p.source = source;
+            Assembler a{p};
+            if (a.layout(current))
+                a.emit();
+            programs.push_back(std::move(p));
+            current.clear();
+            title.clear();
+        };
+
+        for (std::size_t i = 0; i < source.size(); ++i)
+        {
+            std::string t{ trim(source[i]) };
+
+            // Строка-разделитель "----- ... -----"
+            if (t.rfind("---", 0) == 0)
+            {
+                std::string name{t};
+                name.erase(0, name.find_first_not_of("- "));
+                while (!name.empty() && (name.back() == '-' || name.back() == ' '))
+                    name.pop_back();
+                title = name;
+                continue;
+            }
+
+            Line l{ splitLine(source[i], static_cast<int>(i + 1)) };
+            if (!inside)
+            {
+                if (l.mnemonic != "AREA")
+                    continue;
+                inside = true;
+            }
+
+            if (l.mnemonic == "END")
+            {
+                finish();
+                inside = false;
+                continue;
+            }
+            if (!l.mnemonic.empty() || !l.label.empty())
+                current.push_back(l);
+        }
+
+        if (inside)
+            finish();
+        return programs;
+    }
+}
+
+namespace Cpu
+{
+    enum class Status { halted, fault, stepLimit };
+
+    // Счетчики одной инструкции при профилировании
+    struct InsnProfile
+    {
+        std::uint64_t count{};
+        std::uint64_t cycles{};
+    };
+
+    struct Result
+    {
+        Status status{Status::halted};
+        std::uint64_t steps{};
+        std::uint64_t cycles{};
+        std::array<std::uint32_t, 16> r{};
+        bool n{}, z{}, c{}, v{};
+        std::string message;
+        std::vector<std::uint8_t> sram;
+        std::vector<InsnProfile> profile;  // по индексам Program::code (только --profile)
+        double seconds{};                  // время интерпретации без подготовки машины
+    };
+
+    // Такты инструкции без учета выполненного перехода
+    constexpr std::uint32_t baseCycles(Op op)
+    {
+        switch (op)
+        {
+        case Op::ldrLit: case Op::ldrImm: case Op::ldrReg: case Op::ldrhImm: case Op::ldrhReg:
+        case Op::ldrbImm: case Op::ldrbReg: case Op::ldrshReg: case Op::ldrsbReg:
+        case Op::strImm: case Op::strReg: case Op::strhImm: case Op::strhReg:
+        case Op::strbImm: case Op::strbReg:
+            return 2;
+        case Op::b: case Op::bx:
+            return 3;
+        case Op::bl:
+            return 4;
+        default:
+            return 1;
+        }
+    }
+
+    inline std::uint32_t bitCount(std::uint32_t x)
+    {
+        std::uint32_t n{0};
+        for (; x; x &= x - 1)
+            ++n;
+        return n;
+    }
+
+    class Machine
+    {
+        const Program& m_prog;
+        std::vector<std::uint8_t> m_sram;
+        std::uint32_t m_faultAddr{};
+
+    public:
+        explicit Machine(const Program& p) : m_prog{p}, m_sram{p.sram} {}
+
+        // Указатель на байты по адресу или nullptr (нет памяти, невыровнено,
+        // запись во Flash)
+        std::uint8_t* at(std::uint32_t addr, std::uint32_t size, bool write)
+        {
+            if (addr & (size - 1))
+                return nullptr;
+            if (addr - Mem::sramBase <= Mem::sramSize - size)
+                return &m_sram[addr - Mem::sramBase];
+            if (!write && addr - Mem::flashBase <= Mem::flashSize - size)
+                return const_cast<std::uint8_t*>(&m_prog.flash[addr - Mem::flashBase]);
+            m_faultAddr = addr;
+            return nullptr;
+        }
+
+        Result run(std::uint64_t maxSteps, bool profile = false)
+        {
+            return profile ? run<true>(maxSteps) : run<false>(maxSteps);
+        }
+
+    private:
+        template <bool Profile>
+        Result run(std::uint64_t maxSteps);
+    };
+
+    template <bool Profile>
+    Result Machine::run(std::uint64_t maxSteps)
+    {
+        Result res;
+        std::vector<Insn> code{ m_prog.code };
+        std::uint32_t r[16]{};
+        r[13] = m_prog.sp;
+        r[14] = 0xFFFFFFFF;
+        std::uint32_t n{0}, z{0}, c{0}, v{0};
+        std::uint64_t cycles{0};
+        std::uint64_t budget{ maxSteps };
+
+        // Такты, накопленные к началу текущей инструкции: разница относится
+        // к ней при переходе к следующей
+        std::vector<InsnProfile> prof(Profile ? m_prog.code.size() : 0);
+        std::uint64_t cyclesBefore{0};
+        std::size_t current{0};
+#define PROFILE_ENTER() do { if constexpr (Profile) { \
+            prof[current].cycles += cycles - cyclesBefore; cyclesBefore = cycles; \
+            current = static_cast<std::size_t>(ip - base); ++prof[current].count; } } while (0)
+
+#if THUMBSIM_THREADED
+        static const void* const handlers[]{
+            &&L_movsImm, &&L_movReg, &&L_movsReg, &&L_mvns,
+            &&L_addsImm, &&L_addsReg, &&L_addReg, &&L_addSpImm, &&L_addRdSp, &&L_subsImm, &&L_subsReg, &&L_subSpImm,
+            &&L_adcs, &&L_sbcs, &&L_rsbs, &&L_cmpImm, &&L_cmpReg, &&L_cmn,
+            &&L_ands, &&L_orrs, &&L_eors, &&L_bics, &&L_tst, &&L_muls,
+            &&L_lslsImm, &&L_lsrsImm, &&L_asrsImm, &&L_lslsReg, &&L_lsrsReg, &&L_asrsReg, &&L_rors,
+            &&L_rev, &&L_rev16, &&L_revsh, &&L_sxtb, &&L_sxth, &&L_uxtb, &&L_uxth,
+            &&L_ldrLit,
+            &&L_ldrImm, &&L_ldrReg, &&L_ldrhImm, &&L_ldrhReg, &&L_ldrbImm, &&L_ldrbReg, &&L_ldrshReg, &&L_ldrsbReg,
+            &&L_strImm, &&L_strReg, &&L_strhImm, &&L_strhReg, &&L_strbImm, &&L_strbReg,
+            &&L_push, &&L_pop,
+            &&L_b, &&L_bcond, &&L_bl, &&L_bx,
+            &&L_nop, &&L_halt, &&L_fault
+        };
+        static_assert(std::size(handlers) == static_cast<std::size_t>(Op::maxOps));
+        for (auto& insn : code)
+            insn.handler = handlers[static_cast<std::size_t>(insn.op)];
+#define OP(name) L_##name
+#define DISPATCH() do { PROFILE_ENTER(); goto *ip->handler; } while (0)
+#else
+#define OP(name) case Op::name
+#define DISPATCH() do { PROFILE_ENTER(); goto dispatch; } while (0)
+#endif
+
+        const Insn* const base{ code.data() };
+        const Insn* ip{ base + m_prog.entry };
+
+        // Переход к следующей инструкции с учетом лимита шагов
+#define NEXT() do { ++ip; if (--budget == 0) goto out_of_steps; DISPATCH(); } while (0)
+#define JUMP(idx) do { ip = base + (idx); if (--budget == 0) goto out_of_steps; DISPATCH(); } while (0)
+#define SETNZ(x) do { n = (x) >> 31; z = ((x) == 0); } while (0)
+#define ADDC(a, b, carry, out) do { \
+            std::uint64_t wide_{ std::uint64_t{a} + (b) + (carry) }; \
+            std::uint32_t res_{ static_cast<std::uint32_t>(wide_) }; \
+            c = static_cast<std::uint32_t>(wide_ >> 32); \
+            v = (((a) ^ res_) & ((b) ^ res_)) >> 31; \
+            SETNZ(res_); out = res_; } while (0)
+#define LOAD(T, width, addrExpr, sext) do { \
+            std::uint32_t a_{ addrExpr }; \
+            std::uint8_t* p_{ at(a_, width, false) }; \
+            if (!p_) { m_faultAddr = a_; goto mem_fault; } \
+            T val_; std::memcpy(&val_, p_, width); \
+            r[ip->rd] = sext ? static_cast<std::uint32_t>(static_cast<std::int32_t>(val_)) : static_cast<std::uint32_t>(val_); \
+            cycles += 2; NEXT(); } while (0)
+#define STORE(T, width, addrExpr) do { \
+            std::uint32_t a_{ addrExpr }; \
+            std::uint8_t* p_{ at(a_, width, true) }; \
+            if (!p_) { m_faultAddr = a_; goto mem_fault; } \
+            T val_{ static_cast<T>(r[ip->rd]) }; std::memcpy(p_, &val_, width); \
+            cycles += 2; NEXT(); } while (0)
+
+        const auto started{ std::chrono::steady_clock::now() };
+        DISPATCH();
+
+#if !THUMBSIM_THREADED
+    dispatch:
+        switch (ip->op)
+        {
+#endif
+        OP(movsImm): r[ip->rd] = ip->imm; SETNZ(ip->imm); cycles += 1; NEXT();
+        OP(movReg): r[ip->rd] = r[ip->rm]; cycles += 1; NEXT();
+        OP(movsReg): r[ip->rd] = r[ip->rm]; SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        OP(mvns): r[ip->rd] = ~r[ip->rm]; SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        OP(addsImm): ADDC(r[ip->rn], ip->imm, 0u, r[ip->rd]); cycles += 1; NEXT();
+        OP(addsReg): { std::uint32_t b_{ r[ip->rm] }; ADDC(r[ip->rn], b_, 0u, r[ip->rd]); } cycles += 1; NEXT();
+        OP(addReg): r[ip->rd] += r[ip->rm]; cycles += 1; NEXT();
+        OP(addSpImm): r[13] += ip->imm; cycles += 1; NEXT();
+        OP(addRdSp): r[ip->rd] = r[13] + ip->imm; cycles += 1; NEXT();
+        OP(subsImm): ADDC(r[ip->rn], ~ip->imm, 1u, r[ip->rd]); cycles += 1; NEXT();
+        OP(subsReg): { std::uint32_t b_{ ~r[ip->rm] }; ADDC(r[ip->rn], b_, 1u, r[ip->rd]); } cycles += 1; NEXT();
+        OP(subSpImm): r[13] -= ip->imm; cycles += 1; NEXT();
+        OP(adcs): { std::uint32_t b_{ r[ip->rm] }, cin_{ c }; ADDC(r[ip->rd], b_, cin_, r[ip->rd]); } cycles += 1; NEXT();
+        OP(sbcs): { std::uint32_t b_{ ~r[ip->rm] }, cin_{ c }; ADDC(r[ip->rd], b_, cin_, r[ip->rd]); } cycles += 1; NEXT();
+        OP(rsbs): { std::uint32_t b_{ ~r[ip->rn] }; ADDC(0u, b_, 1u, r[ip->rd]); } cycles += 1; NEXT();
+        OP(cmpImm): { std::uint32_t t_; ADDC(r[ip->rn], ~ip->imm, 1u, t_); (void)t_; } cycles += 1; NEXT();
+        OP(cmpReg): { std::uint32_t t_, b_{ ~r[ip->rm] }; ADDC(r[ip->rn], b_, 1u, t_); (void)t_; } cycles += 1; NEXT();
+        OP(cmn): { std::uint32_t t_, b_{ r[ip->rm] }; ADDC(r[ip->rn], b_, 0u, t_); (void)t_; } cycles += 1; NEXT();
+        OP(ands): r[ip->rd] &= r[ip->rm]; SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        OP(orrs): r[ip->rd] |= r[ip->rm]; SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        OP(eors): r[ip->rd] ^= r[ip->rm]; SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        OP(bics): r[ip->rd] &= ~r[ip->rm]; SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        OP(tst): { std::uint32_t t_{ r[ip->rd] & r[ip->rm] }; SETNZ(t_); } cycles += 1; NEXT();
+        OP(muls): r[ip->rd] *= r[ip->rm]; SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        OP(lslsImm):
+        {
+            std::uint32_t a_{ r[ip->rm] };
+            if (ip->imm)
+                c = (a_ >> (32 - ip->imm)) & 1;
+            r[ip->rd] = a_ << ip->imm;
+            SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        }
+        OP(lsrsImm):
+        {
+            std::uint32_t a_{ r[ip->rm] };
+            c = (a_ >> (ip->imm - 1)) & 1;
+            r[ip->rd] = (ip->imm == 32) ? 0 : a_ >> ip->imm;
+            SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        }
+        OP(asrsImm):
+        {
+            std::int32_t a_{ static_cast<std::int32_t>(r[ip->rm]) };
+            c = (static_cast<std::uint32_t>(a_) >> (ip->imm - 1)) & 1;
+            r[ip->rd] = static_cast<std::uint32_t>((ip->imm == 32) ? (a_ >> 31) : (a_ >> ip->imm));
+            SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        }
+        OP(lslsReg):
+        {
+            std::uint32_t a_{ r[ip->rd] }, s_{ r[ip->rn] & 0xFF };
+            if (s_ == 0) {}
+            else if (s_ < 32) { c = (a_ >> (32 - s_)) & 1; a_ <<= s_; }
+            else { c = (s_ == 32) ? (a_ & 1) : 0; a_ = 0; }
+            r[ip->rd] = a_; SETNZ(a_); cycles += 1; NEXT();
+        }
+        OP(lsrsReg):
+        {
+            std::uint32_t a_{ r[ip->rd] }, s_{ r[ip->rn] & 0xFF };
+            if (s_ == 0) {}
+            else if (s_ < 32) { c = (a_ >> (s_ - 1)) & 1; a_ >>= s_; }
+            else { c = (s_ == 32) ? (a_ >> 31) : 0; a_ = 0; }
+            r[ip->rd] = a_; SETNZ(a_); cycles += 1; NEXT();
+        }
+        OP(asrsReg):
+        {
+            std::int32_t a_{ static_cast<std::int32_t>(r[ip->rd]) };
+            std::uint32_t s_{ r[ip->rn] & 0xFF };
+            if (s_ == 0) {}
+            else if (s_ < 32) { c = (static_cast<std::uint32_t>(a_) >> (s_ - 1)) & 1; a_ >>= s_; }
+            else { c = static_cast<std::uint32_t>(a_) >> 31; a_ >>= 31; }
+            r[ip->rd] = static_cast<std::uint32_t>(a_); SETNZ(r[ip->rd]); cycles += 1; NEXT();
+        }
+        OP(rors):
+        {
+            std::uint32_t a_{ r[ip->rd] }, s_{ r[ip->rn] & 0xFF };
+            if (s_ != 0)
+            {
+                s_ &= 31;
+                if (s_)
+                    a_ = (a_ >> s_) | (a_ << (32 - s_));
+                c = a_ >> 31;
+            }
+            r[ip->rd] = a_; SETNZ(a_); cycles += 1; NEXT();
+        }
+        OP(rev):
+        {
+            std::uint32_t a_{ r[ip->rm] };
+            r[ip->rd] = (a_ >> 24) | ((a_ >> 8) & 0xFF00) | ((a_ << 8) & 0xFF0000) | (a_ << 24);
+            cycles += 1; NEXT();
+        }
+        OP(rev16):
+        {
+            std::uint32_t a_{ r[ip->rm] };
+            r[ip->rd] = ((a_ >> 8) & 0x00FF00FF) | ((a_ << 8) & 0xFF00FF00);
+            cycles += 1; NEXT();
+        }
+        OP(revsh):
+        {
+            std::uint32_t a_{ r[ip->rm] };
+            r[ip->rd] = static_cast<std::uint32_t>(static_cast<std::int16_t>(((a_ & 0xFF) << 8) | ((a_ >> 8) & 0xFF)));
+            cycles += 1; NEXT();
+        }
+        OP(sxtb): r[ip->rd] = static_cast<std::uint32_t>(static_cast<std::int8_t>(r[ip->rm])); cycles += 1; NEXT();
+        OP(sxth): r[ip->rd] = static_cast<std::uint32_t>(static_cast<std::int16_t>(r[ip->rm])); cycles += 1; NEXT();
+        OP(uxtb): r[ip->rd] = r[ip->rm] & 0xFF; cycles += 1; NEXT();
+        OP(uxth): r[ip->rd] = r[ip->rm] & 0xFFFF; cycles += 1; NEXT();
+        OP(ldrLit): r[ip->rd] = ip->imm; cycles += 2; NEXT();
+        OP(ldrImm): LOAD(std::uint32_t, 4, r[ip->rn] + ip->imm, false);
+        OP(ldrReg): LOAD(std::uint32_t, 4, r[ip->rn] + r[ip->rm], false);
+        OP(ldrhImm): LOAD(std::uint16_t, 2, r[ip->rn] + ip->imm, false);
+        OP(ldrhReg): LOAD(std::uint16_t, 2, r[ip->rn] + r[ip->rm], false);
+        OP(ldrbImm): LOAD(std::uint8_t, 1, r[ip->rn] + ip->imm, false);
+        OP(ldrbReg): LOAD(std::uint8_t, 1, r[ip->rn] + r[ip->rm], false);
+        OP(ldrshReg): LOAD(std::int16_t, 2, r[ip->rn] + r[ip->rm], true);
+        OP(ldrsbReg): LOAD(std::int8_t, 1, r[ip->rn] + r[ip->rm], true);
+        OP(strImm): STORE(std::uint32_t, 4, r[ip->rn] + ip->imm);
+        OP(strReg): STORE(std::uint32_t, 4, r[ip->rn] + r[ip->rm]);
+        OP(strhImm): STORE(std::uint16_t, 2, r[ip->rn] + ip->imm);
+        OP(strhReg): STORE(std::uint16_t, 2, r[ip->rn] + r[ip->rm]);
+        OP(strbImm): STORE(std::uint8_t, 1, r[ip->rn] + ip->imm);
+        OP(strbReg): STORE(std::uint8_t, 1, r[ip->rn] + r[ip->rm]);
+        OP(push):
+        {
+            std::uint32_t mask_{ ip->imm };
+            std::uint32_t count_{ bitCount(mask_) };
+            std::uint32_t sp_{ r[13] - 4 * count_ };
+            std::uint32_t a_{ sp_ };
+            for (int i = 0; i < 16; ++i)
+            {
+                if (!(mask_ & (1u << i)))
+                    continue;
+                std::uint8_t* p_{ at(a_, 4, true) };
+                if (!p_) { m_faultAddr = a_; goto mem_fault; }
+                std::memcpy(p_, &r[i], 4);
+                a_ += 4;
+            }
+            r[13] = sp_;
+            cycles += 1 + count_;
+            NEXT();
+        }
+        OP(pop):
+        {
+            std::uint32_t mask_{ ip->imm };
+            std::uint32_t count_{ bitCount(mask_) };
+            std::uint32_t a_{ r[13] };
+            for (int i = 0; i < 16; ++i)
+            {
+                if (!(mask_ & (1u << i)))
+                    continue;
+                std::uint8_t* p_{ at(a_, 4, false) };
+                if (!p_) { m_faultAddr = a_; goto mem_fault; }
+                std::memcpy(&r[i], p_, 4);
+                a_ += 4;
+            }
+            r[13] = a_;
+            cycles += 1 + count_;
+            if (mask_ & (1u << 15))
+            {
+                cycles += 3;
+                std::uint32_t to_{ r[15] & ~1u };
+                if (to_ < Mem::flashBase || to_ - Mem::flashBase >= Mem::flashSize
+                    || m_prog.addrToIndex[(to_ - Mem::flashBase) / 2] < 0)
+                { m_faultAddr = to_; goto bad_jump; }
+                JUMP(static_cast<std::uint32_t>(m_prog.addrToIndex[(to_ - Mem::flashBase) / 2]));
+            }
+            NEXT();
+        }
+        OP(b): cycles += 3; JUMP(ip->target);
+        OP(bcond):
+        {
+            bool take_{};
+            switch (ip->cond)
+            {
+            case Cond::eq: take_ = z; break;
+            case Cond::ne: take_ = !z; break;
+            case Cond::cs: take_ = c; break;
+            case Cond::cc: take_ = !c; break;
+            case Cond::mi: take_ = n; break;
+            case Cond::pl: take_ = !n; break;
+            case Cond::vs: take_ = v; break;
+            case Cond::vc: take_ = !v; break;
+            case Cond::hi: take_ = c && !z; break;
+            case Cond::ls: take_ = !c || z; break;
+            case Cond::ge: take_ = n == v; break;
+            case Cond::lt: take_ = n != v; break;
+            case Cond::gt: take_ = !z && n == v; break;
+            case Cond::le: take_ = z || n != v; break;
+            case Cond::al: take_ = true; break;
+            }
+            if (take_)
+            {
+                cycles += 3;
+                JUMP(ip->target);
+            }
+            cycles += 1;
+            NEXT();
+        }
+        OP(bl):
+            r[14] = (ip->addr + 4) | 1;
+            cycles += 4;
+            JUMP(ip->target);
+        OP(bx):
+        {
+            std::uint32_t to_{ r[ip->rm] & ~1u };
+            cycles += 3;
+            if (to_ < Mem::flashBase || to_ - Mem::flashBase >= Mem::flashSize
+                || m_prog.addrToIndex[(to_ - Mem::flashBase) / 2] < 0)
+            { m_faultAddr = to_; goto bad_jump; }
+            JUMP(static_cast<std::uint32_t>(m_prog.addrToIndex[(to_ - Mem::flashBase) / 2]));
+        }
+        OP(nop): cycles += 1; NEXT();
+        OP(halt):
+            res.status = Status::halted;
+            goto done;
+        OP(fault):
+            res.status = Status::fault;
+            res.message = "выполнение вышло за конец кода";
+            goto done;
+#if !THUMBSIM_THREADED
+        default:
+            res.status = Status::fault;
+            res.message = "неизвестная операция";
+            goto done;
+        }
+#endif
+
+    mem_fault:
+        {
+            std::ostringstream msg;
+            msg << "ошибка доступа к памяти по адресу 0x" << std::hex << std::setw(8) << std::setfill('0')
+                << m_faultAddr << std::dec << " (строка " << ip->line << ")";
+            res.status = Status::fault;
+            res.message = msg.str();
+            goto done;
+        }
+    bad_jump:
+        {
+            std::ostringstream msg;
+            msg << "переход на 0x" << std::hex << m_faultAddr << std::dec << " вне кода (строка " << ip->line << ")";
+            res.status = Status::fault;
+            res.message = msg.str();
+            goto done;
+        }
+    out_of_steps:
+        res.status = Status::stepLimit;
+        res.message = "превышен лимит шагов";
+
+    done:
+        res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        res.steps = maxSteps - budget;
+        res.cycles = cycles;
+        std::copy(std::begin(r), std::end(r), res.r.begin());
+        // r[15] в отчете - адрес инструкции, на которой остановились
+        res.r[15] = ip->addr;
+        res.n = n; res.z = z; res.c = c; res.v = v;
+        res.sram = m_sram;
+        if constexpr (Profile)
+        {
+            prof[current].cycles += cycles - cyclesBefore;
+            res.profile = std::move(prof);
+        }
+        return res;
+
+#undef OP
+#undef DISPATCH
+#undef PROFILE_ENTER
+#undef NEXT
+#undef JUMP
+#undef SETNZ
+#undef ADDC
+#undef LOAD
+#undef STORE
+    }
+}
+
+namespace Report
+{
+    std::string statusName(Cpu::Status s)
+    {
+        switch (s)
+        {
+        case Cpu::Status::halted: return "ok";
+        case Cpu::Status::fault: return "FAULT";
+        case Cpu::Status::stepLimit: return "LIMIT";
+        }
+        return "?";
+    }
+
+    // Дополнение строки пробелами до ширины в символах (не в байтах UTF-8)
+    std::string pad(const std::string& s, std::size_t width, bool left = true)
+    {
+        std::size_t chars{ static_cast<std::size_t>(std::count_if(s.begin(), s.end(),
+            [](char ch) { return (static_cast<unsigned char>(ch) & 0xC0) != 0x80; })) };
+        std::string fill(chars < width ? width - chars : 0, ' ');
+        return left ? s + fill : fill + s;
+    }
+
+    // Контрольная сумма SRAM (FNV-1a) для сравнения результатов между прогонами
+    std::uint32_t checksum(const std::vector<std::uint8_t>& mem)
+    {
+        std::uint32_t h{ 2166136261u };
+        for (auto b : mem)
+            h = (h ^ b) * 16777619u;
+        return h;
+    }
+
+    // Плоский профиль по меткам и листинг с тактами по строкам
+    void profile(const Cpu::Result& res, const Program& prog)
+    {
+        const auto& code{ prog.code };
+        const auto& prof{ res.profile };
+        if (prof.empty() || res.cycles == 0)
+            return;
+
+        // Метка, к которой относится каждая инструкция
+        std::vector<std::string> owner(code.size(), "(до первой метки)");
+        std::vector<bool> entry(code.size(), false);
+        std::string label{ owner[0] };
+        for (std::size_t i = 0; i + 1 < code.size(); ++i)
+        {
+            auto it{ prog.labels.find(code[i].addr) };
+            if (it != prog.labels.end())
+            {
+                label = it->second;
+                entry[i] = true;
+            }
+            owner[i] = label;
+        }
+
+        struct Row
+        {
+            std::string label;
+            std::uint64_t entries{}, insns{}, cycles{};
+        };
+        std::vector<Row> rows;
+        for (std::size_t i = 0; i + 1 < code.size(); ++i)
+        {
+            if (rows.empty() || rows.back().label != owner[i])
+                rows.push_back({ owner[i] });
+            Row& row{ rows.back() };
+            if (entry[i] || i == prog.entry)
+                row.entries += prof[i].count;
+            row.insns += prof[i].count;
+            row.cycles += prof[i].cycles;
+        }
+        std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.cycles > b.cycles; });
+
+        std::cout << "\n  " << pad("метка", 24) << pad("входов", 10, false) << pad("инструкций", 12, false)
+                  << pad("тактов", 10, false) << pad("%", 8, false) << pad("такт/вход", 11, false) << '\n';
+        for (const Row& row : rows)
+        {
+            if (row.insns == 0)
+                continue;
+            std::cout << "  " << pad(row.label, 24) << std::setw(10) << row.entries << std::setw(12) << row.insns
+                      << std::setw(10) << row.cycles << std::fixed << std::setprecision(1)
+                      << std::setw(8) << 100.0 * static_cast<double>(row.cycles) / static_cast<double>(res.cycles)
+                      << std::setw(11);
+            if (row.entries)
+                std::cout << static_cast<double>(row.cycles) / static_cast<double>(row.entries);
+            else
+                std::cout << '-';
+            std::cout << '\n';
+        }
+        std::cout.unsetf(std::ios::floatfield);
+
+        // Листинг: строки от первой до последней инструкции программы
+        int first{ code.front().line }, last{ code[code.size() - 2].line };
+        std::map<int, std::size_t> byLine;
+        for (std::size_t i = 0; i + 1 < code.size(); ++i)
+            byLine[code[i].line] = i;
+
+        std::cout << "\n  " << pad("раз", 9, false) << pad("тактов", 9, false) << pad("перех.", 8, false)
+                  << "  строка\n";
+        for (int line = first; line <= last; ++line)
+        {
+            const std::string& text{ prog.source[static_cast<std::size_t>(line - 1)] };
+            auto it{ byLine.find(line) };
+            if (it == byLine.end())
+            {
+                std::cout << "  " << std::string(26, ' ') << std::setw(6) << line << "  " << text << '\n';
+                continue;
+            }
+            const Cpu::InsnProfile& p{ prof[it->second] };
+            std::cout << "  " << std::setw(9) << p.count << std::setw(9) << p.cycles;
+            // Выполненные условные переходы стоят на 2 такта дороже
+            if (code[it->second].op == Op::bcond)
+                std::cout << std::setw(8) << (p.cycles - p.count * Cpu::baseCycles(Op::bcond)) / 2;
+            else
+                std::cout << std::setw(8) << "";
+            std::cout << std::setw(6) << line << "  " << text << '\n';
+        }
+        std::cout << '\n';
+    }
+
+    void dump(const Cpu::Result& res, const Program& prog)
+    {
+        std::cout << "  начальный SP = 0x" << std::hex << std::setw(8) << std::setfill('0') << prog.sp
+                  << ", вход = 0x" << std::setw(8) << prog.code[prog.entry].addr << std::dec << std::setfill(' ') << '\n';
+        for (int i = 0; i < 16; ++i)
+        {
+            std::cout << "  R" << std::left << std::setw(2) << std::setfill(' ') << std::dec << i << std::right
+                      << " = 0x" << std::hex << std::setw(8) << std::setfill('0') << res.r[i];
+            if (i % 4 == 3)
+                std::cout << '\n';
+        }
+        std::cout << std::dec << "  N=" << res.n << " Z=" << res.z << " C=" << res.c << " V=" << res.v << '\n';
+
+        // Ненулевые строки SRAM по 16 байт
+        std::cout << std::hex;
+        for (std::uint32_t off = 0; off < Mem::sramSize; off += 16)
+        {
+            if (std::all_of(res.sram.begin() + off, res.sram.begin() + off + 16, [](auto b) { return b == 0; }))
+                continue;
+            std::cout << "  " << std::setw(8) << (Mem::sramBase + off) << ':';
+            for (std::uint32_t k = 0; k < 16; ++k)
+                std::cout << ' ' << std::setw(2) << static_cast<unsigned>(res.sram[off + k]);
+            std::cout << '\n';
+        }
+        std::cout << std::dec << std::setfill(' ');
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool dump{false};
+    bool profile{false};
+    int bench{1};
+    std::uint64_t maxSteps{ 10'000'000 };
+    std::vector<std::filesystem::path> inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a{ argv[i] };
+        if (a == "--dump")
+            dump = true;
+        else if (a == "--profile")
+            profile = true;
+        else if (a == "--bench" && i + 1 < argc)
+            bench = std::max(1, std::stoi(argv[++i]));
+        else if (a == "--steps" && i + 1 < argc)
+            maxSteps = std::stoull(argv[++i]);
+        else
+            inputs.emplace_back(a);
+    }
+
+    if (inputs.empty())
+    {
+        std::cerr << "Запуск: " << argv[0] << " [--dump] [--profile] [--bench N] [--steps N] файл|каталог ...\n";
+        return 2;
+    }
+
+    // Каталоги обходятся рекурсивно, файлы *.txt и *.s в алфавитном порядке
+    std::vector<std::filesystem::path> files;
+    for (const auto& in : inputs)
+    {
+        if (std::filesystem::is_directory(in))
+        {
+            for (const auto& e : std::filesystem::recursive_directory_iterator(in))
+            {
+                auto ext{ e.path().extension().string() };
+                if (e.is_regular_file() && (ext == ".txt" || ext == ".s"))
+                    files.push_back(e.path());
+            }
+        }
+        else
+            files.push_back(in);
+    }
+    std::sort(files.begin(), files.end());
+
+    int failed{0};
+    std::uint64_t totalSteps{0};
+    double totalSeconds{0};
+
+    std::cout << Report::pad("программа", 18) << Report::pad("итог", 7) << Report::pad("шаги", 10, false)
+              << Report::pad("такты", 10, false) << Report::pad("SRAM", 10, false) << "  название\n";
+
+    for (const auto& file : files)
+    {
+        for (const Program& prog : Asm::assembleFile(file))
+        {
+            std::cout << std::left << std::setw(18) << prog.name;
+            if (!prog.error.empty())
+            {
+                std::cout << std::setw(7) << "ASM" << prog.error << '\n';
+                ++failed;
+                continue;
+            }
+
+            // В MIPS входит только интерпретация: копия SRAM и кода на
+            // каждый прогон для коротких программ стоит дороже их выполнения
+            Cpu::Result res;
+            for (int k = 0; k < bench; ++k)
+            {
+                Cpu::Machine m{prog};
+                res = m.run(maxSteps, profile);
+                totalSeconds += res.seconds;
+            }
+            totalSteps += res.steps * static_cast<std::uint64_t>(bench);
+
+            std::cout << std::setw(7) << Report::statusName(res.status) << std::right
+                      << std::setw(10) << res.steps << std::setw(10) << res.cycles
+                      << "  " << std::hex << std::setw(8) << std::setfill('0') << Report::checksum(res.sram)
+                      << std::dec << std::setfill(' ') << "  " << prog.title;
+            if (!res.message.empty())
+                std::cout << (prog.title.empty() ? "" : "; ") << res.message;
+            std::cout << '\n';
+
+            if (res.status != Cpu::Status::halted)
+                ++failed;
+            if (dump)
+                Report::dump(res, prog);
+            if (profile)
+                Report::profile(res, prog);
+        }
+    }
+
+    std::cout << "\nвсего шагов: " << totalSteps << ", время интерпретации: "
+              << std::fixed << std::setprecision(3) << totalSeconds * 1e3 << " мс";
+    if (totalSeconds > 0)
+        std::cout << ", " << std::setprecision(1) << totalSteps / totalSeconds / 1e6 << " MIPS";
+    std::cout << "\nне завершились нормально: " << failed << '\n';
+
+    return failed ? 1 : 0;
+}
@@ -1,4 +1,5 @@
 ﻿#include <stm32f0xx.h>
+#include "scheduler.h"
 
 /* Функция инициализации светодиодов D1-D16 и линий управления цветом */
 void leds_init(void)
@@ -110,40 +111,30 @@ void timer_init()
 uint32_t led = 0x30000; /* Начальное состояние - включен самый левый светодиод */
 /* Переменная для сохранения цвета светодиодов */
 uint16_t color = RED; /* Начальное состояние - красный цвет */
-/* Переменная для подсчета количества переполнений */
-uint16_t up_cnt = 0;
 /* Переменная для сохранения яркости - код в канале выходного сравнения */
 uint16_t brightness = 250;
 /* Начальное состояние яркости */
 uint16_t bright_cond = 0; 
 
+/* События планировщика от кнопок и переключателей */
+#define EVT_SB1     SCHED_EVT(0)
+#define EVT_SB2     SCHED_EVT(1)
+#define EVT_SW      SCHED_EVT(2)
+
+/* Период сдвига светодиода при PSC = 8, мс */
+#define SHIFT_MS    250
+/* Время подавления дребезга кнопок, мс */
+#define DEBOUNCE_MS 200
+
+/* Номер таймера сдвига светодиода */
+int shift_timer = -1;
+
 /* Подпрограмма обработчик прерываний по переполнению таймера */
 void TIM1_BRK_UP_TRG_COM_IRQHandler(void)
 {
     /* Сброс флага вызвавшего прерывание */
     TIM1->SR &= ~TIM_SR_UIF;
 
-    /* Подсчет количества переполнений таймера.
-       Между каждым переполнением проходит по 1 мс */
-    up_cnt++;
-
-    /* Если прошло больше 250 мс */
-    if (up_cnt > 250)
-    {
-        /* Подсчет заново */
-        up_cnt = 0;
-        /* Сдвиг маски светодиода на одну позицию вправо */
-        led = led >> 1;
-    }
-
-    /* Если сдвиг произошел дальше 1 светодиода */
-    if (led == 0x00)
-    {
-        /* Начинается сдвиг с шестнадцатого светодиода */
-        led = 0x30000;
-
-    }
-
     /* Включение светодиода с нужным цветом */
     led_set(led, color);
 
@@ -159,13 +150,107 @@ void TIM1_CC_IRQHandler(void)
     /* Выключение всех светодиодов */
     led_set(0, color);
 }
-/* Временная задержка */
-void software_delay(int ticks)
+
+/* Сдвиг маски светодиода на одну позицию вправо (таймер планировщика) */
+void led_shift(void)
+{
+    led = led >> 1;
+
+    /* Если сдвиг произошел дальше 1 светодиода */
+    if (led == 0x00)
+    {
+        /* Начинается сдвиг с шестнадцатого светодиода */
+        led = 0x30000;
+    }
+}
+
+/* Окончание подавления дребезга - линии кнопок снова разрешены */
+void sb1_unmask(void)
+{
+    sched_exti_enable(4, 1);
+}
+
+void sb2_unmask(void)
 {
-	while (ticks > 0)
-	{
-		ticks = ticks - 1;
-	}
+    sched_exti_enable(5, 1);
+}
+
+/* Изменение яркости по нажатию SB1 */
+void on_sb1(void)
+{
+    if (bright_cond == 0)
+    {
+        brightness = 999;
+        bright_cond = 1;
+    }
+    else if (bright_cond == 1)
+    {
+        brightness = 750;
+        bright_cond = 2;
+    }
+    else if (bright_cond == 2)
+    {
+        brightness = 500;
+        bright_cond = 3;
+    }
+    else if (bright_cond == 3)
+    {
+        brightness = 250;
+        bright_cond = 0;
+    }
+
+    /* Вместо программной задержки - запрет линии на время дребезга */
+    sched_exti_enable(4, 0);
+    sched_timer_start(sb1_unmask, DEBOUNCE_MS, 0);
+}
+
+/* Изменение цвета по нажатию SB2 */
+void on_sb2(void)
+{
+    if (color == RED)
+    {
+        color = GREEN;
+    }
+    else if (color == GREEN)
+    {
+        color = BLUE;
+    }
+    else if (color == BLUE)
+    {
+        color = RED;
+    }
+
+    sched_exti_enable(5, 0);
+    sched_timer_start(sb2_unmask, DEBOUNCE_MS, 0);
+}
+
+/* Изменение скорости по положению переключателей SW1, SW2 */
+void on_sw(void)
+{
+    /* Чтение состояния линий PA11 (SW1) и PA12 (SW2) */
+    int sw1 = GPIOA->IDR & (1 << 11);
+    int sw2 = GPIOA->IDR & (1 << 12);
+
+    if (sw2 == 0 && sw1 == 0)
+    {
+        TIM1->PSC = 8;
+    }
+    else if (sw2 == 0 && sw1 != 0)
+    {
+        TIM1->PSC = 6;
+    }
+    else if (sw2 != 0 && sw1 == 0)
+    {
+        TIM1->PSC = 4;
+    }
+    else
+    {
+        TIM1->PSC = 2;
+    }
+
+    /* Раньше сдвиг происходил каждые 250 переполнений TIM1, поэтому
+       период сдвига пропорционален (PSC + 1) */
+    sched_timer_period(shift_timer, SHIFT_MS * (TIM1->PSC + 1) / 9);
 }
 
 /* Функция main - точка входа в программу */
@@ -175,80 +260,28 @@ int main(void)
     leds_init();
     /* Инициализация таймера TIM1 */
     timer_init();
-    
-    /* Бесконечный цикл */
-    while (1)
-    {
-        /* Объявление переменной sb1 и чтение состояние линии PB4 (SB1) */
-        int sb1 = GPIOB->IDR & (1 << 4);
-        /* Объявление переменной sb2 и чтение состояние линии PB5 (SB2) */
-        int sb2 = GPIOB->IDR & (1 << 5);
-
-			  /* Изменение яркости */
-				if (sb1 == 0)
-				{
-						if (bright_cond == 0)
-						{
-								brightness = 999;
-								bright_cond = 1;
-								software_delay(500000);
-						}
-						else if (bright_cond == 1)
-						{	
-								brightness = 750;
-								bright_cond = 2;
-								software_delay(500000);
-						}
-						else if (bright_cond == 2)
-						{	
-								brightness = 500;
-								bright_cond = 3;
-								software_delay(500000);
-						}
-						else if (bright_cond == 3)
-						{	
-								brightness = 250;
-								bright_cond = 0;
-								software_delay(500000);
-						}
-				}
-			  /* Изменение цвета */
-				if (sb2 == 0)
-				{
-						if (color == RED)
-						{
-								color = GREEN;
-								software_delay(500000);
-						}
-						else if (color == GREEN)
-						{	
-								color = BLUE;
-								software_delay(500000);
-						}
-						else if (color == BLUE)
-						{	
-								color = RED;
-								software_delay(500000);
-						}
-				}
-			
-        /* Объявление переменной sw1 и чтение состояние линии PA11 (SW1) */
-        int sw1 = GPIOA->IDR & (1 << 11);
-        /* Объявление переменной sw2 и чтение состояние линии PA12 (SW2) */
-        int sw2 = GPIOA->IDR & (1 << 12);
-				
-				/* Изменение скорости */
-        if (sw2 == 0 && sw1 == 0){
-					TIM1->PSC = 8;
-				}
-				else if (sw2 == 0 && sw1 != 0){
-					TIM1->PSC = 6;
-				}
-				else if (sw2 != 0 && sw1 == 0){
-					TIM1->PSC = 4;
-				}
-				else if (sw2 != 0 && sw1 != 0){
-					TIM1->PSC = 2;
-				}
-    }
+    /* Инициализация планировщика */
+    sched_init();
+
+    /* ШИМ яркости на TIM1 не работает в режиме Stop */
+    sched_stop_lock();
+
+    /* Кнопки SB1 (PB4), SB2 (PB5) - по нажатию, переключатели SW1 (PA11),
+       SW2 (PA12) - по любому изменению положения */
+    sched_exti(4, SCHED_PORT_B, SCHED_EDGE_FALLING, EVT_SB1);
+    sched_exti(5, SCHED_PORT_B, SCHED_EDGE_FALLING, EVT_SB2);
+    sched_exti(11, SCHED_PORT_A, SCHED_EDGE_FALLING | SCHED_EDGE_RISING, EVT_SW);
+    sched_exti(12, SCHED_PORT_A, SCHED_EDGE_FALLING | SCHED_EDGE_RISING, EVT_SW);
+
+    sched_on_event(EVT_SB1, on_sb1);
+    sched_on_event(EVT_SB2, on_sb2);
+    sched_on_event(EVT_SW, on_sw);
+
+    shift_timer = sched_timer_start(led_shift, SHIFT_MS, SHIFT_MS);
+
+    /* Начальное положение переключателей */
+    on_sw();
+
+    /* Бесконечный цикл обработки событий, в простое - WFI */
+    sched_run();
 }
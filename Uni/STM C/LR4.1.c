@@ -1,4 +1,5 @@
 #include <stm32f0xx.h>
+#include "scheduler.h"
 
 /* Функция инициализации светодиодов D1-D8 и линий управления цветом */
 void leds_init(void)
@@ -24,18 +25,11 @@ void leds_init(void)
 #define BLUE    0x4
 
 //uint16_t led = 0xFFFF;
-int speed = 400000;
+/* Период мигания, мс */
+uint32_t speed = 2000;
 
-void software_delay(int ticks)
-{
-	while (ticks > 0)
-	{
-		ticks = ticks - 1;
-	}
-}
-int blink = 1;
 /* Функция включения светодиодов и выбора цвета */
-void led_set(uint8_t led, uint8_t color)
+void led_set(uint8_t led)
 {
     /* Записываем в регистр данных порта C новое состояние светодиодов.
        Номер бита соответствует номеру светодиода: бит 0 - D1, бит 1 - D2 и
@@ -113,45 +107,53 @@ int32_t _strcmp(char s1[], char s2[])
     return s1[i] - s2[i];
 }
 
-void timer_init()
-{
-    RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
-
-    TIM1->PSC = 8;
-
-    TIM1->ARR = 999;
-
-    TIM1->CCR1 = 0;
+/* Событие планировщика: принят байт по USART2 */
+#define EVT_RX      SCHED_EVT(0)
 
-    TIM1->DIER |= TIM_DIER_UIE;
+/* Кольцевой буфер принятых байтов, наполняется в прерывании */
+#define RX_SIZE     32
+volatile uint8_t rx_buf[RX_SIZE];
+volatile uint8_t rx_head = 0;
+uint8_t rx_tail = 0;
 
-    NVIC_SetPriority(TIM1_BRK_UP_TRG_COM_IRQn, 0);
-
-    NVIC_EnableIRQ(TIM1_BRK_UP_TRG_COM_IRQn);
+/* Подпрограмма обработчик прерывания USART2 по приему байта */
+void USART2_IRQHandler(void)
+{
+    if (USART2->ISR & USART_ISR_RXNE)
+    {
+        /* Чтение RDR сбрасывает флаг RXNE */
+        rx_buf[rx_head % RX_SIZE] = USART2->RDR;
+        rx_head++;
+        sched_post(EVT_RX);
+    }
+}
 
+/* Разрешение прерывания по приему вместо ожидания в цикле */
+void usart_rx_irq_init(void)
+{
+    USART2->CR1 |= USART_CR1_RXNEIE;
+    NVIC_SetPriority(USART2_IRQn, 0);
+    NVIC_EnableIRQ(USART2_IRQn);
 }
 
-uint16_t up_cnt = 0;
 uint8_t led = 0xFF;
+/* Номер таймера планировщика, мигающего светодиодами (-1 - не мигаем) */
+int blink_timer = -1;
 
-void TIM1_BRK_UP_TRG_COM_IRQHandler(int time_speed)
+/* Переключение светодиодов. Вызывается планировщиком каждые speed мс
+   вместо подсчета переполнений TIM1 в прерывании */
+void led_toggle(void)
 {
-    TIM1->SR &= ~TIM_SR_UIF;
-
-    up_cnt++;
-
-    if (up_cnt > speed)
-    {
-        up_cnt = 0;
-        led = ~led;
-    }
-
+    led = ~led;
     led_set(led);
 }
 
 void led_blink()
 {
-	TIM1->CR1 |= TIM_CR1_CEN;
+    if (blink_timer < 0)
+    {
+        blink_timer = sched_timer_start(led_toggle, speed, speed);
+    }
 }
 
 void led_speed()
@@ -164,32 +166,27 @@ void led_speed()
         speed = 250;
     else if(speed == 250)
         speed = 2000;
+
+    sched_timer_period(blink_timer, speed);
 }
 
 void led_stop()
 {
-	TIM1->CR1 &= ~TIM_CR1_CEN;
+    sched_timer_stop(blink_timer);
+    blink_timer = -1;
 }
 
-/* Функция main - точка входа в программу */
-int main(void)
-{
-    /* Инициализация светодиодов D1-D8 и управления цветом */
-    leds_init();
-	
-    /* Инициализация таймера TIM1 */
-    usart_init();
+/* Объявления массива buf и инициализация нулями. */
+char buf[20] = {0};
+int32_t pos = 0;
 
-    timer_init();
-	
-    /* Объявления массива buf и инициализация нулями. */
-    char buf[20] = {0};
-    int32_t pos = 0;
-
-    /* Бесконечный цикл */
-    while (1)
+/* Обработка принятых байтов (событие EVT_RX) */
+void on_rx(void)
+{
+    while (rx_tail != rx_head)
     {
-        char ch = usart_receive();
+        char ch = rx_buf[rx_tail % RX_SIZE];
+        rx_tail++;
 
         /* Наполнение буфера если не нажата клавиша Enter.
            Символ `\r` передается при нажатии клавиши Enter в терминале. */
@@ -234,3 +231,25 @@ int main(void)
         }
     }
 }
+
+/* Функция main - точка входа в программу */
+int main(void)
+{
+    /* Инициализация светодиодов D1-D8 и управления цветом */
+    leds_init();
+	
+    /* Инициализация USART2 */
+    usart_init();
+    usart_rx_irq_init();
+
+    /* Инициализация планировщика */
+    sched_init();
+
+    /* Прием USART2 требует тактирования - режим Stop запрещен */
+    sched_stop_lock();
+
+    sched_on_event(EVT_RX, on_rx);
+
+    /* Бесконечный цикл обработки событий, в простое - WFI */
+    sched_run();
+}
@@ -0,0 +1,14 @@
+/* Экземпляры регистров периферии для хост-сборки (см. stm32f0xx.h) */
+#include "stm32f0xx.h"
+
+RCC_TypeDef    host_RCC;
+GPIO_TypeDef   host_GPIOA;
+GPIO_TypeDef   host_GPIOB;
+GPIO_TypeDef   host_GPIOC;
+TIM_TypeDef    host_TIM1;
+TIM_TypeDef    host_TIM2;
+USART_TypeDef  host_USART2;
+EXTI_TypeDef   host_EXTI;
+SYSCFG_TypeDef host_SYSCFG;
+PWR_TypeDef    host_PWR;
+SCB_Type       host_SCB;
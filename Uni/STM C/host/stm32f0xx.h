@@ -0,0 +1,181 @@
+/* Хост-заглушка заголовка stm32f0xx.h.
+   Позволяет собирать лабораторные программы на ПК (gcc -I host ...) и
+   гонять их в симуляторе. Регистры периферии - обычные глобальные
+   структуры, значения битов совпадают с CMSIS для STM32F0. */
+#ifndef STM32F0XX_HOST_H
+#define STM32F0XX_HOST_H
+
+#include <stdint.h>
+
+#define __IO volatile
+
+/* Номера прерываний (как в CMSIS) */
+typedef enum
+{
+    EXTI0_1_IRQn              = 5,
+    EXTI2_3_IRQn              = 6,
+    EXTI4_15_IRQn             = 7,
+    TIM1_BRK_UP_TRG_COM_IRQn  = 13,
+    TIM1_CC_IRQn              = 14,
+    TIM2_IRQn                 = 15,
+    USART2_IRQn               = 28
+} IRQn_Type;
+
+typedef struct
+{
+    __IO uint32_t AHBENR;
+    __IO uint32_t APB2ENR;
+    __IO uint32_t APB1ENR;
+} RCC_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t MODER;
+    __IO uint32_t PUPDR;
+    __IO uint32_t IDR;
+    __IO uint32_t ODR;
+    __IO uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CR1;
+    __IO uint32_t DIER;
+    __IO uint32_t SR;
+    __IO uint32_t EGR;
+    __IO uint32_t CNT;
+    __IO uint32_t PSC;
+    __IO uint32_t ARR;
+    __IO uint32_t CCR1;
+} TIM_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CR1;
+    __IO uint32_t BRR;
+    __IO uint32_t ISR;
+    __IO uint32_t ICR;
+    __IO uint32_t RDR;
+    __IO uint32_t TDR;
+} USART_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t IMR;
+    __IO uint32_t EMR;
+    __IO uint32_t RTSR;
+    __IO uint32_t FTSR;
+    __IO uint32_t SWIER;
+    __IO uint32_t PR;
+} EXTI_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t EXTICR[4];
+} SYSCFG_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t CR;
+} PWR_TypeDef;
+
+typedef struct
+{
+    __IO uint32_t SCR;
+} SCB_Type;
+
+/* Экземпляры периферии определены в stm32f0xx.c */
+extern RCC_TypeDef    host_RCC;
+extern GPIO_TypeDef   host_GPIOA, host_GPIOB, host_GPIOC;
+extern TIM_TypeDef    host_TIM1, host_TIM2;
+extern USART_TypeDef  host_USART2;
+extern EXTI_TypeDef   host_EXTI;
+extern SYSCFG_TypeDef host_SYSCFG;
+extern PWR_TypeDef    host_PWR;
+extern SCB_Type       host_SCB;
+
+#define RCC     (&host_RCC)
+#define GPIOA   (&host_GPIOA)
+#define GPIOB   (&host_GPIOB)
+#define GPIOC   (&host_GPIOC)
+#define TIM1    (&host_TIM1)
+#define TIM2    (&host_TIM2)
+#define USART2  (&host_USART2)
+#define EXTI    (&host_EXTI)
+#define SYSCFG  (&host_SYSCFG)
+#define PWR     (&host_PWR)
+#define SCB     (&host_SCB)
+
+/* RCC */
+#define RCC_AHBENR_GPIOAEN      0x00020000U
+#define RCC_AHBENR_GPIOBEN      0x00040000U
+#define RCC_AHBENR_GPIOCEN      0x00080000U
+#define RCC_APB2ENR_SYSCFGEN    0x00000001U
+#define RCC_APB2ENR_TIM1EN      0x00000800U
+#define RCC_APB1ENR_TIM2EN      0x00000001U
+#define RCC_APB1ENR_USART2EN    0x00020000U
+#define RCC_APB1ENR_PWREN       0x10000000U
+
+/* GPIO */
+#define GPIO_MODER_MODER0_0     (1U << 0)
+#define GPIO_MODER_MODER1_0     (1U << 2)
+#define GPIO_MODER_MODER2_0     (1U << 4)
+#define GPIO_MODER_MODER3_0     (1U << 6)
+#define GPIO_MODER_MODER4_0     (1U << 8)
+#define GPIO_MODER_MODER5_0     (1U << 10)
+#define GPIO_MODER_MODER6_0     (1U << 12)
+#define GPIO_MODER_MODER7_0     (1U << 14)
+#define GPIO_MODER_MODER8_0     (1U << 16)
+#define GPIO_MODER_MODER9_0     (1U << 18)
+#define GPIO_MODER_MODER10_0    (1U << 20)
+#define GPIO_MODER_MODER11_0    (1U << 22)
+#define GPIO_MODER_MODER12_0    (1U << 24)
+#define GPIO_MODER_MODER13_0    (1U << 26)
+#define GPIO_MODER_MODER14_0    (1U << 28)
+#define GPIO_MODER_MODER15_0    (1U << 30)
+#define GPIO_MODER_MODER2       (3U << 4)
+#define GPIO_MODER_MODER3       (3U << 6)
+#define GPIO_MODER_MODER2_1     (2U << 4)
+#define GPIO_MODER_MODER3_1     (2U << 6)
+#define GPIO_PUPDR_PUPDR4_0     (1U << 8)
+#define GPIO_PUPDR_PUPDR5_0     (1U << 10)
+#define GPIO_PUPDR_PUPDR11_0    (1U << 22)
+#define GPIO_PUPDR_PUPDR12_0    (1U << 24)
+#define GPIO_AFRL_AFRL2_Pos     8U
+#define GPIO_AFRL_AFRL3_Pos     12U
+#define GPIO_AFRL_AFSEL2_Pos    8U
+#define GPIO_AFRL_AFSEL3_Pos    12U
+
+/* TIM */
+#define TIM_CR1_CEN             0x0001U
+#define TIM_DIER_UIE            0x0001U
+#define TIM_DIER_CC1IE          0x0002U
+#define TIM_SR_UIF              0x0001U
+#define TIM_SR_CC1IF            0x0002U
+#define TIM_EGR_UG              0x0001U
+
+/* USART */
+#define USART_CR1_UE            0x0001U
+#define USART_CR1_RE            0x0004U
+#define USART_CR1_TE            0x0008U
+#define USART_CR1_RXNEIE        0x0020U
+#define USART_CR1_TCIE          0x0040U
+#define USART_CR1_TXEIE         0x0080U
+#define USART_ISR_RXNE          0x0020U
+#define USART_ISR_TC            0x0040U
+#define USART_ISR_TXE           0x0080U
+
+/* PWR / SCB */
+#define PWR_CR_LPDS             0x0001U
+#define SCB_SCR_SLEEPDEEP_Msk   0x0004U
+
+/* Функции ядра. Реализуются симулятором: __WFI продвигает модельное
+   время до ближайшего прерывания и вызывает его обработчик. */
+void __WFI(void);
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void NVIC_SetPriority(IRQn_Type irq, uint32_t prio) { (void)irq; (void)prio; }
+static inline void NVIC_EnableIRQ(IRQn_Type irq) { (void)irq; }
+static inline void NVIC_DisableIRQ(IRQn_Type irq) { (void)irq; }
+
+#endif
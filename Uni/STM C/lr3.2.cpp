@@ -1,86 +1,145 @@
 #include <iostream>
-#include <chrono>
 #include <vector>
-#include <random>
-#include <thread>
+#include <algorithm>
+#include <unistd.h>
+#include "reaction_log.h"
+#include "reaction_schedule.h"
+#include "reaction_timing.h"
 
 using namespace std;
-using namespace std::chrono;
 
-// Структура для хранения информации о стимуле
-struct Stimulus {
-    int variant;  // Вариант предъявления стимула (0, 1, 2)
-    string content;  // Содержимое стимула (например, текст)
+// Погрешности времени одной пробы, нс
+struct TrialTiming {
+    rt::ns_t onsetError;  // запаздывание предъявления стимула относительно срока
+    rt::ns_t maskError;   // запаздывание маскера
+    rt::ns_t promptError; // запаздывание приглашения нажать кнопку
 };
 
-// Функция для генерации случайного числа
-int getRandomNumber(int min, int max) {
-    random_device rd;  
-    mt19937 gen(rd()); 
-    uniform_int_distribution<> distr(min, max);  
-    return distr(gen);
+// Вывод строки сразу в терминал, минуя буфер cout
+void show(const string& line) {
+    ssize_t written = write(STDOUT_FILENO, line.data(), line.size());
+    (void)written;
 }
 
-int main() {
-    // Вектор стимулов
-    vector<Stimulus> stimuli = {
-        {0, "Стимул 0"},  
-        {1, "Стимул 1"},  
-        {2, "Стимул 2"}   
-    };
+// Запуск: lr3.2 [журнал.rtl|журнал.csv] [номер сессии] [описание эксперимента]
+int main(int argc, char* argv[]) {
+    const string logPath = argc > 1 ? argv[1] : "trials.rtl";
+    const uint32_t session = argc > 2 ? static_cast<uint32_t>(stoul(argv[2])) : static_cast<uint32_t>(getpid());
 
-    // Пороговые значения задержек
-    const int minDelay = 200;  
-    const int maxDelay = 500;  
-    const int maskDuration = 500; 
+    // Описание эксперимента: из файла или три стимула по умолчанию
+    rt::ExperimentDef def = rt::defaultExperiment();
+    if (argc > 3) {
+        string error;
+        if (!rt::loadExperiment(argv[3], def, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+    }
+
+    // Все случайные величины и строки стимулов вычисляются заранее
+    const vector<rt::Trial> trials = rt::buildSchedule(def, session);
+    const string readyLine = "Готовьтесь... \n";
+    const string maskLine = "Маскер отображается...\n";
+    const string promptLine = "Нажмите кнопку!\n";
+
+    // Нажатия читаются без построчной буферизации
+    rt::KeyInput keys;
+    cout << "Источник нажатий: " << keys.source() << endl;
+
+    // Буфер журнала выделяется до начала проб
+    rt::TrialRecorder recorder(trials.size());
+    uint16_t trialNo = 0;
+
+    rt::ns_t worstError = 0;
 
     // Основной цикл по каждому стимулу
-    for (const auto& stim : stimuli) {
-        cout << "Готовьтесь... " << endl;
+    for (const auto& stim : trials) {
+        show(readyLine);
+        TrialTiming timing{};
 
-        // Задержка перед предъявлением стимула
-        int randomDelay = getRandomNumber(minDelay, maxDelay);
-        this_thread::sleep_for(milliseconds(randomDelay));  // Пауза для имитации ожидания
+        // Все сроки пробы отсчитываются от одного абсолютного момента
+        rt::ns_t onsetDue = rt::now() + stim.delayMs * rt::msec;
 
-        // Фиксируем время начала предъявления стимула
-        auto start = high_resolution_clock::now();
+        // Задержка перед предъявлением стимула
+        rt::ns_t onset = rt::sleepUntil(onsetDue);
+        show(stim.stimulusLine);
+        timing.onsetError = onset - onsetDue;
 
-        // Отображение стимула
-        cout << "Предъявляется: " << stim.content << endl;
+        rt::ns_t promptDue = onset;
 
         // Если стимул требует маскирования
-        if (stim.variant == 1) {
-            this_thread::sleep_for(milliseconds(16));  // Время затухания стимула
-            cout << "Маскер отображается..." << endl;
-            this_thread::sleep_for(milliseconds(maskDuration));  // Время маскирования
+        if (stim.fadeMs > 0) {
+            rt::ns_t maskDue = onset + stim.fadeMs * rt::msec;  // Время затухания стимула
+            rt::ns_t mask = rt::sleepUntil(maskDue);
+            show(maskLine);
+            timing.maskError = mask - maskDue;
+            promptDue = maskDue + stim.maskMs * rt::msec;  // Время маскирования
         }
 
-        // Ожидание нажатия кнопки или истечения времени
-        cout << "Нажмите кнопку!" << endl;
-        auto reactionStart = high_resolution_clock::now();
-        string response;
-        cin >> response;
+        // Ожидание нажатия кнопки или истечения времени. Нажатия, сделанные
+        // до приглашения (в том числе во время маски), отбрасываются сразу
+        // перед открытием окна ответа
+        rt::ns_t reactionStart = rt::sleepUntil(promptDue);
+        keys.drain();
+        show(promptLine);
+        timing.promptError = reactionStart - promptDue;
+
+        rt::ns_t pressedAt = 0;
+        bool pressed = keys.waitPress(reactionStart + def.responseMs * rt::msec, pressedAt);
 
         // Фиксируем время реакции
-        auto reactionEnd = high_resolution_clock::now();
-        auto reactionTime = duration_cast<milliseconds>(reactionEnd - reactionStart).count();
+        double reactionTime = (pressedAt - reactionStart) / double(rt::msec);
 
         // Проверка на ошибки
-        if (reactionTime < 100) {
-            cout << "Ошибка: Нажато слишком рано!" << endl;
-        } else if (reactionTime > 1000) {
-            cout << "Ошибка: Нажато слишком поздно!" << endl;
-        } else if (stim.variant == 0 && !response.empty()) {
-            cout << "Ошибка: Не надо было нажимать!" << endl;
-        } else if (stim.variant == 2 && response.empty()) {
-            cout << "Ошибка: Надо было нажать!" << endl;
-        } else {
-            cout << "Время реакции: " << reactionTime << " мсек." << endl;
+        rt::Outcome outcome = rt::Outcome::correct;
+        if (stim.variant == 0 && pressed) {
+            outcome = rt::Outcome::falsePress;
+        } else if (stim.variant != 0 && !pressed) {
+            outcome = rt::Outcome::miss;
+        } else if (pressed && reactionTime < 100) {
+            outcome = rt::Outcome::tooEarly;
         }
 
+        recorder.record({session, trialNo++, static_cast<uint8_t>(stim.variant), outcome,
+                         pressed ? static_cast<int32_t>((pressedAt - reactionStart) / rt::usec) : -1,
+                         static_cast<int32_t>(timing.onsetError / rt::usec),
+                         static_cast<int32_t>(timing.maskError / rt::usec),
+                         static_cast<int32_t>(timing.promptError / rt::usec)});
+
+        // Обратная связь участнику - после окна ответа, без сброса буфера на
+        // каждой строке
+        switch (outcome) {
+        case rt::Outcome::falsePress: cout << "Ошибка: Не надо было нажимать!\n"; break;
+        case rt::Outcome::miss:       cout << "Ошибка: Надо было нажать!\n"; break;
+        case rt::Outcome::tooEarly:   cout << "Ошибка: Нажато слишком рано!\n"; break;
+        default:
+            if (pressed)
+                cout << "Время реакции: " << reactionTime << " мсек.\n";
+            else
+                cout << "Верно: нажатия не было.\n";
+            break;
+        }
+
+        // Погрешность предъявления, мкс
+        cout << "Погрешность: стимул " << timing.onsetError / rt::usec
+             << " мкс, маскер " << timing.maskError / rt::usec
+             << " мкс, приглашение " << timing.promptError / rt::usec << " мкс\n";
+        cout.flush();
+
+        worstError = max({worstError, timing.onsetError, timing.maskError, timing.promptError});
+
         // Пауза перед следующим стимулом
-        this_thread::sleep_for(milliseconds(1000));
+        rt::sleepUntil(rt::now() + def.pauseMs * rt::msec);
+    }
+
+    cout << "Наибольшая погрешность предъявления: " << worstError / rt::usec << " мкс" << endl;
+
+    // Журнал пишется на диск только после окончания всех проб
+    if (!recorder.flush(logPath)) {
+        cerr << "Не удалось записать журнал " << logPath << endl;
+        return 1;
     }
+    cout << "Журнал: " << logPath << " (" << recorder.records().size() << " проб)" << endl;
 
     return 0;
 }
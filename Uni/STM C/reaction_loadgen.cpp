@@ -0,0 +1,266 @@
+// Нагрузочный генератор для lr3.2: синтетические участники через псевдотерминалы.
+//
+// Сборка: g++ -std=c++17 -O2 reaction_loadgen.cpp -o reaction_loadgen -lutil -pthread
+// Запуск: reaction_loadgen <путь к lr3.2> [параметры]
+//     --sessions N      одновременных сессий (по умолчанию 100)
+//     --burn K          потоков, занимающих процессор (по умолчанию 0)
+//     --mean M --sd S   нормальная часть времени реакции, мс (300, 40)
+//     --tau T           экспоненциальная часть (экс-гауссово), мс (80)
+//     --press P         вероятность нажатия на приглашение (1.0)
+//     --experiment F    описание эксперимента для lr3.2
+//     --seed X          зерно генератора времени реакции
+//     --dir D           каталог для журналов сессий (/tmp)
+//
+// Каждая сессия - процесс lr3.2 на своем псевдотерминале (forkpty), так что
+// программа работает в том же неканоническом режиме termios, что и с
+// человеком. Один поток с epoll читает вывод всех сессий; увидев
+// "Нажмите кнопку!", участник выбирает время реакции и в назначенный
+// момент пишет клавишу в терминал. После завершения сессий журналы lr3.2
+// сравниваются с заданными временами: разница - ошибка измерения (вывод в
+// терминал + ввод + планирование), которая растет с нагрузкой на процессор.
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+#include <pty.h>
+#include <unistd.h>
+#include "reaction_log.h"
+#include "reaction_timing.h"
+
+using namespace std;
+
+// Синтетический участник одной сессии
+struct Session {
+    pid_t pid = -1;
+    int fd = -1;
+    string pending;            // непрочитанный остаток вывода (неполная строка)
+    vector<int64_t> injected;  // заданное время реакции по пробам, мкс (-1 - не нажимал)
+    string logPath;
+    bool done = false;
+};
+
+// Запланированное нажатие
+struct Press {
+    rt::ns_t due;
+    size_t session;
+    bool operator>(const Press& other) const { return due > other.due; }
+};
+
+// Простая статистика ошибок измерения
+void report(const char* title, vector<int64_t>& v) {
+    if (v.empty()) {
+        cout << title << ": нет данных\n";
+        return;
+    }
+    sort(v.begin(), v.end());
+    double sum = 0;
+    for (auto x : v)
+        sum += x;
+    auto q = [&](double p) { return v[min(v.size() - 1, static_cast<size_t>(p * v.size()))]; };
+    cout << title << ": n=" << v.size()
+         << " среднее=" << sum / v.size()
+         << " p50=" << q(0.50) << " p95=" << q(0.95) << " p99=" << q(0.99)
+         << " макс=" << v.back() << " мкс\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Запуск: " << argv[0] << " <путь к lr3.2> [--sessions N] [--burn K] [--mean M] [--sd S] "
+                "[--tau T] [--press P] [--experiment F] [--seed X] [--dir D]" << endl;
+        return 1;
+    }
+
+    const string program = argv[1];
+    int sessions = 100, burn = 0;
+    double meanMs = 300, sdMs = 40, tauMs = 80, pressProb = 1.0;
+    string experiment, dir = "/tmp";
+    uint32_t seed = 1;
+
+    for (int i = 2; i < argc; i += 2) {
+        string key = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << key << endl;
+            return 1;
+        }
+        string val = argv[i + 1];
+        if (key == "--sessions") sessions = stoi(val);
+        else if (key == "--burn") burn = stoi(val);
+        else if (key == "--mean") meanMs = stod(val);
+        else if (key == "--sd") sdMs = stod(val);
+        else if (key == "--tau") tauMs = stod(val);
+        else if (key == "--press") pressProb = stod(val);
+        else if (key == "--experiment") experiment = val;
+        else if (key == "--seed") seed = static_cast<uint32_t>(stoul(val));
+        else if (key == "--dir") dir = val;
+        else {
+            cerr << "Неизвестный параметр " << key << endl;
+            return 1;
+        }
+    }
+
+    // Потоки, создающие конкуренцию за процессор
+    atomic<bool> stopBurn{false};
+    vector<thread> burners;
+    for (int i = 0; i < burn; ++i) {
+        burners.emplace_back([&stopBurn] {
+            volatile uint64_t x = 0;
+            while (!stopBurn.load(memory_order_relaxed))
+                ++x;
+        });
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int ep = epoll_create1(0);
+    vector<Session> all(static_cast<size_t>(sessions));
+
+    for (size_t i = 0; i < all.size(); ++i) {
+        Session& s = all[i];
+        // Уникальное имя: несколько генераторов могут писать в один каталог
+        string path = dir + "/loadgen_session_" + to_string(i) + "_XXXXXX.csv";
+        int logFd = mkstemps(&path[0], 4);
+        if (logFd < 0) {
+            cerr << "mkstemps " << path << ": " << strerror(errno) << endl;
+            return 1;
+        }
+        close(logFd);
+        s.logPath = path;
+
+        pid_t pid = forkpty(&s.fd, nullptr, nullptr, nullptr);
+        if (pid < 0) {
+            cerr << "forkpty: " << strerror(errno) << endl;
+            return 1;
+        }
+        if (pid == 0) {
+            string sessionNo = to_string(i);
+            if (experiment.empty())
+                execl(program.c_str(), program.c_str(), s.logPath.c_str(), sessionNo.c_str(), static_cast<char*>(nullptr));
+            else
+                execl(program.c_str(), program.c_str(), s.logPath.c_str(), sessionNo.c_str(), experiment.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        s.pid = pid;
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, s.fd, &ev);
+    }
+
+    // Время реакции: нормальное + экспоненциальное (экс-гауссово)
+    mt19937 gen(seed);
+    normal_distribution<double> normal(meanMs, sdMs);
+    exponential_distribution<double> expo(tauMs > 0 ? 1.0 / tauMs : 1.0);
+    bernoulli_distribution press(pressProb);
+
+    priority_queue<Press, vector<Press>, greater<Press>> presses;
+    const string prompt = "Нажмите кнопку!";
+    size_t alive = all.size();
+    epoll_event events[64];
+    char buf[4096];
+
+    while (alive > 0) {
+        // Ожидание до ближайшего нажатия или вывода сессий
+        int timeoutMs = -1;
+        if (!presses.empty())
+            timeoutMs = static_cast<int>(max<rt::ns_t>(0, presses.top().due - rt::now() - rt::spinMargin) / rt::msec);
+
+        int n = epoll_wait(ep, events, 64, timeoutMs);
+        for (int k = 0; k < n; ++k) {
+            Session& s = all[events[k].data.u64];
+            ssize_t got = read(s.fd, buf, sizeof buf);
+            if (got <= 0) {
+                // Сессия завершилась (EIO на мастере псевдотерминала)
+                epoll_ctl(ep, EPOLL_CTL_DEL, s.fd, nullptr);
+                close(s.fd);
+                s.done = true;
+                --alive;
+                continue;
+            }
+
+            rt::ns_t seen = rt::now();
+            s.pending.append(buf, static_cast<size_t>(got));
+            size_t pos;
+            while ((pos = s.pending.find('\n')) != string::npos) {
+                if (s.pending.find(prompt) < pos) {
+                    double ms = press(gen) ? max(0.0, normal(gen)) + (tauMs > 0 ? expo(gen) : 0.0) : -1.0;
+                    if (ms >= 0) {
+                        auto us = static_cast<int64_t>(ms * 1000);
+                        s.injected.push_back(us);
+                        presses.push({seen + us * rt::usec, events[k].data.u64});
+                    } else {
+                        s.injected.push_back(-1);
+                    }
+                }
+                s.pending.erase(0, pos + 1);
+            }
+        }
+
+        // Нажатия, срок которых наступил (последние сотни мкс - активное ожидание)
+        while (!presses.empty() && presses.top().due - rt::now() <= rt::spinMargin) {
+            Press p = presses.top();
+            presses.pop();
+            rt::sleepUntil(p.due);
+            Session& s = all[p.session];
+            if (!s.done) {
+                ssize_t w = write(s.fd, "x", 1);
+                (void)w;
+            }
+        }
+    }
+
+    for (auto& s : all) {
+        int status;
+        waitpid(s.pid, &status, 0);
+    }
+
+    stopBurn = true;
+    for (auto& t : burners)
+        t.join();
+
+    // Сравнение измеренного с заданным
+    vector<int64_t> errors;
+    size_t lost = 0, mismatched = 0;
+    for (auto& s : all) {
+        rt::TrialReader reader(s.logPath);
+        if (!reader.ok()) {
+            ++mismatched;
+            continue;
+        }
+        rt::TrialRecord r;
+        size_t i = 0;
+        while (reader.next(r)) {
+            if (i >= s.injected.size())
+                break;
+            int64_t want = s.injected[i++];
+            if (want < 0)
+                continue;
+            if (r.reactionUs < 0)
+                ++lost;  // нажатие не попало в окно ответа
+            else
+                errors.push_back(r.reactionUs - want);
+        }
+        if (i != s.injected.size())
+            ++mismatched;
+        remove(s.logPath.c_str());
+    }
+
+    cout << "Сессий: " << sessions << ", потоков нагрузки: " << burn
+         << ", ядер: " << thread::hardware_concurrency() << '\n';
+    report("Ошибка измерения (измерено - задано)", errors);
+    if (lost)
+        cout << "Нажатий вне окна ответа: " << lost << '\n';
+    if (mismatched)
+        cout << "Сессий с несовпавшим журналом: " << mismatched << '\n';
+
+    return 0;
+}
@@ -0,0 +1,218 @@
+// Журнал проб эксперимента на время реакции.
+//
+// Во время эксперимента пробы пишутся в заранее выделенный буфер в памяти
+// (TrialRecorder::record не выделяет память и не делает ввода-вывода).
+// После эксперимента буфер сбрасывается в файл: двоичный (.rtl) или CSV
+// (любое другое расширение). Двоичный формат - заголовок FileHeader и
+// следом count записей TrialRecord в порядке байтов хоста.
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace rt
+{
+    // Исход пробы
+    enum class Outcome : std::uint8_t
+    {
+        correct,     // верное нажатие или верное отсутствие нажатия
+        tooEarly,    // нажатие раньше 100 мс
+        falsePress,  // нажатие там, где нажимать было не нужно
+        miss,        // нет нажатия там, где оно было нужно
+        maxOutcomes
+    };
+
+    // Одна проба. Время в микросекундах, -1 - нажатия не было
+    struct TrialRecord
+    {
+        std::uint32_t session;
+        std::uint16_t trial;
+        std::uint8_t variant;
+        Outcome outcome;
+        std::int32_t reactionUs;
+        std::int32_t onsetErrorUs;
+        std::int32_t maskErrorUs;
+        std::int32_t promptErrorUs;
+    };
+    static_assert(sizeof(TrialRecord) == 24, "TrialRecord is written to disk as is");
+
+    struct FileHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t count;
+    };
+
+    constexpr char fileMagic[4]{ 'R', 'T', 'L', '1' };
+    constexpr std::uint32_t fileVersion{ 1 };
+
+    inline bool isBinaryPath(const std::string& path)
+    {
+        return path.size() >= 4 && path.compare(path.size() - 4, 4, ".rtl") == 0;
+    }
+
+    class TrialRecorder
+    {
+        std::vector<TrialRecord> m_records;
+        std::size_t m_dropped{0};
+
+    public:
+        explicit TrialRecorder(std::size_t capacity) { m_records.reserve(capacity); }
+
+        // Запись пробы. Если буфер полон, проба отбрасывается (и считается),
+        // чтобы не выделять память на пути измерения
+        void record(const TrialRecord& r)
+        {
+            if (m_records.size() < m_records.capacity())
+                m_records.push_back(r);
+            else
+                ++m_dropped;
+        }
+
+        const std::vector<TrialRecord>& records() const { return m_records; }
+        std::size_t dropped() const { return m_dropped; }
+
+        // Сброс журнала в файл. Возвращает false при ошибке записи
+        bool flush(const std::string& path) const
+        {
+            std::FILE* f{ std::fopen(path.c_str(), isBinaryPath(path) ? "wb" : "w") };
+            if (!f)
+                return false;
+
+            bool ok{ true };
+            if (isBinaryPath(path))
+            {
+                FileHeader h{};
+                std::memcpy(h.magic, fileMagic, sizeof h.magic);
+                h.version = fileVersion;
+                h.count = m_records.size();
+                ok = std::fwrite(&h, sizeof h, 1, f) == 1
+                    && std::fwrite(m_records.data(), sizeof(TrialRecord), m_records.size(), f) == m_records.size();
+            }
+            else
+            {
+                std::fputs("session,trial,variant,outcome,reaction_us,onset_error_us,mask_error_us,prompt_error_us\n", f);
+                for (const auto& r : m_records)
+                {
+                    std::fprintf(f, "%u,%u,%u,%u,%d,%d,%d,%d\n",
+                                 r.session, r.trial, r.variant, static_cast<unsigned>(r.outcome),
+                                 r.reactionUs, r.onsetErrorUs, r.maskErrorUs, r.promptErrorUs);
+                }
+            }
+
+            return (std::fclose(f) == 0) && ok;
+        }
+    };
+
+    // Последовательное чтение журнала (двоичного или CSV) с постоянным
+    // объемом памяти
+    class TrialReader
+    {
+        std::FILE* m_file{nullptr};
+        bool m_binary{false};
+        std::uint64_t m_left{0};
+        TrialRecord m_chunk[4096];
+        std::size_t m_chunkSize{0};
+        std::size_t m_chunkPos{0};
+        std::uint64_t m_row{0};
+        std::string m_path;
+
+        bool read(TrialRecord& r)
+        {
+            if (!m_binary)
+            {
+                unsigned session, trial, variant, outcome;
+                if (std::fscanf(m_file, "%u,%u,%u,%u,%d,%d,%d,%d", &session, &trial, &variant, &outcome,
+                                &r.reactionUs, &r.onsetErrorUs, &r.maskErrorUs, &r.promptErrorUs) != 8)
+                    return false;
+                r.session = session;
+                r.trial = static_cast<std::uint16_t>(trial);
+                r.variant = static_cast<std::uint8_t>(variant);
+                r.outcome = static_cast<Outcome>(outcome < 256 ? outcome : 255);
+                return true;
+            }
+
+            if (m_chunkPos == m_chunkSize)
+            {
+                if (m_left == 0)
+                    return false;
+                std::size_t want{ m_left < std::size(m_chunk) ? static_cast<std::size_t>(m_left) : std::size(m_chunk) };
+                m_chunkSize = std::fread(m_chunk, sizeof(TrialRecord), want, m_file);
+                m_chunkPos = 0;
+                m_left -= m_chunkSize;
+                if (m_chunkSize == 0)
+                {
+                    m_left = 0;
+                    return false;
+                }
+            }
+
+            r = m_chunk[m_chunkPos++];
+            return true;
+        }
+
+    public:
+        explicit TrialReader(const std::string& path)
+            : m_binary{ isBinaryPath(path) }, m_path{ path }
+        {
+            m_file = std::fopen(path.c_str(), m_binary ? "rb" : "r");
+            if (!m_file)
+                return;
+
+            if (m_binary)
+            {
+                FileHeader h{};
+                if (std::fread(&h, sizeof h, 1, m_file) != 1
+                    || std::memcmp(h.magic, fileMagic, sizeof h.magic) != 0
+                    || h.version != fileVersion)
+                {
+                    std::fclose(m_file);
+                    m_file = nullptr;
+                    return;
+                }
+                m_left = h.count;
+            }
+            else
+            {
+                // Пропуск строки заголовка
+                int c;
+                while ((c = std::fgetc(m_file)) != EOF && c != '\n')
+                {
+                }
+            }
+        }
+
+        ~TrialReader()
+        {
+            if (m_file)
+                std::fclose(m_file);
+        }
+
+        TrialReader(const TrialReader&) = delete;
+        TrialReader& operator=(const TrialReader&) = delete;
+
+        bool ok() const { return m_file != nullptr; }
+
+        // Следующая запись. Записи с неизвестным исходом пропускаются с
+        // сообщением в stderr
+        bool next(TrialRecord& r)
+        {
+            if (!m_file)
+                return false;
+
+            while (read(r))
+            {
+                ++m_row;
+                if (r.outcome < Outcome::maxOutcomes)
+                    return true;
+                std::fprintf(stderr, "%s: запись %llu: неизвестный исход %u, пропущена\n", m_path.c_str(),
+                             static_cast<unsigned long long>(m_row), static_cast<unsigned>(r.outcome));
+            }
+            return false;
+        }
+    };
+}
@@ -0,0 +1,193 @@
+// Расписание проб эксперимента на время реакции.
+//
+// Описание эксперимента читается из текстового файла (пример -
+// reaction_experiment.txt):
+//
+//     # комментарий
+//     seed 12345          - зерно генератора (вместе с номером сессии)
+//     response 1000       - окно ответа, мс
+//     pause 1000          - пауза между пробами, мс
+//     block 6             - размер блока уравновешивания (0 - без блоков)
+//     variant <вариант> <проб> <задержка от> <до> <затухание> <маска> <текст>
+//
+// Вся случайность вычисляется до начала эксперимента: порядок проб,
+// задержки и готовые к выводу строки лежат в векторе Trial. Одинаковые
+// описание и номер сессии дают одинаковую последовательность.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace rt
+{
+    // Описание одного варианта стимула
+    struct VariantDef
+    {
+        int variant{};
+        int count{};
+        int minDelayMs{};
+        int maxDelayMs{};
+        int fadeMs{};     // время до маскера (0 - без маскера)
+        int maskMs{};     // длительность маскера
+        std::string content;
+    };
+
+    struct ExperimentDef
+    {
+        std::uint32_t seed{1};
+        int responseMs{1000};
+        int pauseMs{1000};
+        int blockSize{0};
+        std::vector<VariantDef> variants;
+    };
+
+    // Эксперимент по умолчанию - три стимула исходной программы
+    inline ExperimentDef defaultExperiment()
+    {
+        ExperimentDef def;
+        def.variants = {
+            {0, 1, 200, 500, 0, 0, "Стимул 0"},
+            {1, 1, 200, 500, 16, 500, "Стимул 1"},
+            {2, 1, 200, 500, 0, 0, "Стимул 2"}
+        };
+        return def;
+    }
+
+    // Чтение описания. При ошибке возвращает false и текст ошибки в error
+    inline bool loadExperiment(const std::string& path, ExperimentDef& def, std::string& error)
+    {
+        std::ifstream in{path};
+        if (!in)
+        {
+            error = "не удалось открыть " + path;
+            return false;
+        }
+
+        def = ExperimentDef{};
+        std::string line;
+        int lineNo{0};
+        while (std::getline(in, line))
+        {
+            ++lineNo;
+            std::istringstream ls{line};
+            std::string key;
+            if (!(ls >> key) || key[0] == '#')
+                continue;
+
+            bool ok{true};
+            if (key == "seed")
+                ok = static_cast<bool>(ls >> def.seed);
+            else if (key == "response")
+                ok = static_cast<bool>(ls >> def.responseMs);
+            else if (key == "pause")
+                ok = static_cast<bool>(ls >> def.pauseMs);
+            else if (key == "block")
+                ok = static_cast<bool>(ls >> def.blockSize);
+            else if (key == "variant")
+            {
+                VariantDef v;
+                ok = static_cast<bool>(ls >> v.variant >> v.count >> v.minDelayMs >> v.maxDelayMs >> v.fadeMs >> v.maskMs);
+                std::getline(ls >> std::ws, v.content);
+                ok = ok && v.count >= 0 && v.minDelayMs <= v.maxDelayMs;
+                if (ok)
+                    def.variants.push_back(v);
+            }
+            else
+                ok = false;
+
+            if (!ok)
+            {
+                error = path + ":" + std::to_string(lineNo) + ": неверная строка";
+                return false;
+            }
+        }
+
+        if (def.variants.empty())
+        {
+            error = path + ": нет ни одного варианта";
+            return false;
+        }
+        return true;
+    }
+
+    // Проба с заранее вычисленными параметрами
+    struct Trial
+    {
+        int variant{};
+        int delayMs{};
+        int fadeMs{};
+        int maskMs{};
+        std::string stimulusLine;  // готовая строка "Предъявляется: ...\n"
+    };
+
+    // Порядок вариантов в блоке. Каждый блок содержит варианты в тех же
+    // пропорциях, что и весь эксперимент, так что утомление и привыкание
+    // распределяются по вариантам поровну
+    inline std::vector<std::size_t> blockOrder(const ExperimentDef& def, std::uint32_t session, std::mt19937& gen)
+    {
+        std::vector<std::size_t> pool;
+        for (std::size_t i = 0; i < def.variants.size(); ++i)
+            pool.insert(pool.end(), static_cast<std::size_t>(def.variants[i].count), i);
+
+        if (def.blockSize <= 0 || static_cast<std::size_t>(def.blockSize) >= pool.size())
+        {
+            std::shuffle(pool.begin(), pool.end(), gen);
+            return pool;
+        }
+
+        // Раскладываем пробы каждого варианта по блокам равномерно
+        // (метод Брезенхема), затем перемешиваем внутри блоков
+        std::size_t blocks{ (pool.size() + def.blockSize - 1) / def.blockSize };
+        std::vector<std::vector<std::size_t>> perBlock(blocks);
+        std::size_t offset{0};
+        for (std::size_t i = 0; i < def.variants.size(); ++i)
+        {
+            std::size_t n{ static_cast<std::size_t>(def.variants[i].count) };
+            for (std::size_t k = 0; k < n; ++k)
+                perBlock[(offset + k * blocks / n) % blocks].push_back(i);
+            offset += n;
+        }
+
+        // Порядок блоков сдвигается на номер сессии (латинский квадрат),
+        // чтобы одни и те же блоки не стояли всегда в начале
+        std::rotate(perBlock.begin(), perBlock.begin() + session % blocks, perBlock.end());
+
+        std::vector<std::size_t> order;
+        order.reserve(pool.size());
+        for (auto& block : perBlock)
+        {
+            std::shuffle(block.begin(), block.end(), gen);
+            order.insert(order.end(), block.begin(), block.end());
+        }
+        return order;
+    }
+
+    inline std::vector<Trial> buildSchedule(const ExperimentDef& def, std::uint32_t session)
+    {
+        // Одно зерно на сессию: генератор создается один раз
+        std::seed_seq seq{ def.seed, session };
+        std::mt19937 gen{ seq };
+
+        std::vector<std::size_t> order{ blockOrder(def, session, gen) };
+
+        std::vector<Trial> trials;
+        trials.reserve(order.size());
+        for (std::size_t idx : order)
+        {
+            const VariantDef& v{ def.variants[idx] };
+            Trial t;
+            t.variant = v.variant;
+            t.delayMs = std::uniform_int_distribution{ v.minDelayMs, v.maxDelayMs }(gen);
+            t.fadeMs = v.fadeMs;
+            t.maskMs = v.maskMs;
+            t.stimulusLine = "Предъявляется: " + v.content + "\n";
+            trials.push_back(std::move(t));
+        }
+        return trials;
+    }
+}
@@ -0,0 +1,123 @@
+// Сводная статистика по журналам эксперимента на время реакции.
+//
+// Запуск: reaction_stats журнал1.rtl [журнал2.csv ...]
+//
+// Журналы читаются потоково, объем памяти не зависит от количества
+// сессий: среднее и СКО считаются по Уэлфорду, медиана - по гистограмме
+// с шагом 0.1 мс (точность медианы - один шаг).
+#include <array>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include "reaction_log.h"
+
+using namespace std;
+
+// Гистограмма времени реакции: 0 - 2000 мс с шагом 100 мкс
+constexpr int binUs = 100;
+constexpr int bins = 2000 * 1000 / binUs;
+
+struct VariantStats {
+    uint64_t trials = 0;
+    array<uint64_t, static_cast<size_t>(rt::Outcome::maxOutcomes)> outcomes{};
+
+    // Время реакции верных нажатий, мс
+    uint64_t n = 0;
+    double mean = 0;
+    double m2 = 0;
+    array<uint32_t, bins + 1> hist{};  // последний элемент - все, что дольше
+
+    // Погрешность предъявления стимула, мкс
+    double onsetErrSum = 0;
+    int32_t onsetErrMax = 0;
+
+    void add(const rt::TrialRecord& r) {
+        ++trials;
+        ++outcomes[static_cast<size_t>(r.outcome)];
+        onsetErrSum += r.onsetErrorUs;
+        onsetErrMax = max(onsetErrMax, r.onsetErrorUs);
+
+        if (r.outcome != rt::Outcome::correct || r.reactionUs < 0)
+            return;
+
+        double x = r.reactionUs / 1000.0;
+        ++n;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+
+        ++hist[min(r.reactionUs / binUs, bins)];
+    }
+
+    double sd() const { return n > 1 ? sqrt(m2 / (n - 1)) : 0.0; }
+
+    double median() const {
+        if (!n)
+            return 0;
+        uint64_t half = (n + 1) / 2, seen = 0;
+        for (int i = 0; i <= bins; ++i) {
+            seen += hist[i];
+            if (seen >= half)
+                return (i + 0.5) * binUs / 1000.0;
+        }
+        return 0;
+    }
+
+    double rate(rt::Outcome o) const {
+        return trials ? 100.0 * outcomes[static_cast<size_t>(o)] / trials : 0.0;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Запуск: " << argv[0] << " журнал.rtl [журнал.csv ...]" << endl;
+        return 1;
+    }
+
+    // Варианты стимулов 0, 1, 2
+    static array<VariantStats, 3> stats;
+    uint64_t total = 0, skipped = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        rt::TrialReader reader(argv[i]);
+        if (!reader.ok()) {
+            cerr << "Не удалось прочитать " << argv[i] << endl;
+            return 1;
+        }
+
+        rt::TrialRecord r;
+        while (reader.next(r)) {
+            if (r.variant >= stats.size()) {
+                ++skipped;
+                continue;
+            }
+            stats[r.variant].add(r);
+            ++total;
+        }
+    }
+
+    cout << "Проб: " << total;
+    if (skipped)
+        cout << " (пропущено с неизвестным вариантом: " << skipped << ")";
+    cout << "\n\n";
+
+    cout << fixed << setprecision(2);
+    cout << "вар.    проб   среднее   медиана       СКО  рано,%  ложн,%  проп,%  погр.ср,мкс  погр.макс,мкс\n";
+    for (size_t v = 0; v < stats.size(); ++v) {
+        const auto& s = stats[v];
+        if (!s.trials)
+            continue;
+        cout << setw(4) << v
+             << setw(8) << s.trials
+             << setw(10) << s.mean
+             << setw(10) << s.median()
+             << setw(10) << s.sd()
+             << setw(8) << s.rate(rt::Outcome::tooEarly)
+             << setw(8) << s.rate(rt::Outcome::falsePress)
+             << setw(8) << s.rate(rt::Outcome::miss)
+             << setw(13) << s.onsetErrSum / s.trials
+             << setw(15) << s.onsetErrMax << '\n';
+    }
+
+    return 0;
+}
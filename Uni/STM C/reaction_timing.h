@@ -0,0 +1,185 @@
+// Движок точного измерения времени реакции (Linux).
+//
+// - Стимулы предъявляются по абсолютным срокам на CLOCK_MONOTONIC:
+//   clock_nanosleep(TIMER_ABSTIME) будит поток чуть раньше срока, остаток
+//   добирается активным ожиданием. Ошибка предъявления (насколько позже
+//   срока реально вышли из ожидания) возвращается для каждого стимула.
+// - Нажатия читаются без построчной буферизации: либо с устройства evdev
+//   (переменная окружения RT_EVDEV=/dev/input/eventN, метка времени ставится
+//   ядром в момент прерывания клавиатуры), либо с терминала в
+//   неканоническом режиме termios (метка ставится при чтении байта).
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace rt
+{
+    using ns_t = std::int64_t;
+
+    constexpr ns_t usec = 1000;
+    constexpr ns_t msec = 1000 * usec;
+
+    // Запас, который добирается активным ожиданием после clock_nanosleep
+    constexpr ns_t spinMargin = 300 * usec;
+
+    inline ns_t now()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ns_t{ts.tv_sec} * 1000000000 + ts.tv_nsec;
+    }
+
+    inline timespec toTimespec(ns_t t)
+    {
+        timespec ts;
+        ts.tv_sec = static_cast<time_t>(t / 1000000000);
+        ts.tv_nsec = static_cast<long>(t % 1000000000);
+        return ts;
+    }
+
+    // Ожидание до абсолютного срока deadline. Возвращает момент выхода
+    // из ожидания (не раньше deadline)
+    inline ns_t sleepUntil(ns_t deadline)
+    {
+        ns_t coarse = deadline - spinMargin;
+        if (now() < coarse)
+        {
+            timespec ts = toTimespec(coarse);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+            {
+            }
+        }
+
+        ns_t t = now();
+        while (t < deadline)
+            t = now();
+        return t;
+    }
+
+    // Источник нажатий
+    class KeyInput
+    {
+        int m_fd{-1};
+        bool m_evdev{false};
+        bool m_restoreTty{false};
+        termios m_saved{};
+
+    public:
+        KeyInput()
+        {
+            if (const char* dev = std::getenv("RT_EVDEV"))
+            {
+                m_fd = open(dev, O_RDONLY | O_NONBLOCK);
+                if (m_fd >= 0)
+                {
+                    // Метки времени событий - в той же шкале, что и now()
+                    int clk = CLOCK_MONOTONIC;
+                    ioctl(m_fd, EVIOCSCLOCKID, &clk);
+                    m_evdev = true;
+                    return;
+                }
+            }
+
+            m_fd = STDIN_FILENO;
+            if (isatty(m_fd) && tcgetattr(m_fd, &m_saved) == 0)
+            {
+                termios raw = m_saved;
+                raw.c_lflag &= ~static_cast<tcflag_t>(ICANON | ECHO);
+                raw.c_cc[VMIN] = 0;
+                raw.c_cc[VTIME] = 0;
+                tcsetattr(m_fd, TCSANOW, &raw);
+                m_restoreTty = true;
+            }
+        }
+
+        ~KeyInput()
+        {
+            if (m_restoreTty)
+                tcsetattr(m_fd, TCSANOW, &m_saved);
+            if (m_evdev)
+                close(m_fd);
+        }
+
+        KeyInput(const KeyInput&) = delete;
+        KeyInput& operator=(const KeyInput&) = delete;
+
+        const char* source() const { return m_evdev ? "evdev" : (m_restoreTty ? "termios" : "pipe"); }
+
+        // Отбрасывает нажатия, сделанные до начала окна ответа
+        void drain()
+        {
+            if (m_evdev)
+            {
+                input_event ev;
+                while (read(m_fd, &ev, sizeof ev) == sizeof ev)
+                {
+                }
+                return;
+            }
+
+            pollfd p{m_fd, POLLIN, 0};
+            char buf[64];
+            while (poll(&p, 1, 0) > 0 && (p.revents & POLLIN))
+            {
+                if (read(m_fd, buf, sizeof buf) <= 0)
+                    break;
+            }
+        }
+
+        // Ожидание нажатия до абсолютного срока deadline. При нажатии
+        // возвращает true и записывает его момент в pressedAt
+        bool waitPress(ns_t deadline, ns_t& pressedAt)
+        {
+            while (true)
+            {
+                ns_t left = deadline - now();
+                if (left <= 0)
+                    return false;
+
+                pollfd p{m_fd, POLLIN, 0};
+                // poll округляет вверх до мс, срок проверяется заново
+                int r = poll(&p, 1, static_cast<int>((left + msec - 1) / msec));
+                if (r < 0 && errno == EINTR)
+                    continue;
+                if (r <= 0)
+                    continue;
+
+                if (m_evdev)
+                {
+                    input_event ev;
+                    while (read(m_fd, &ev, sizeof ev) == sizeof ev)
+                    {
+                        // Нажатие клавиши (value 1), автоповтор и отпускание игнорируются
+                        if (ev.type == EV_KEY && ev.value == 1)
+                        {
+                            pressedAt = ns_t{ev.input_event_sec} * 1000000000 + ns_t{ev.input_event_usec} * 1000;
+                            return true;
+                        }
+                    }
+                    continue;
+                }
+
+                pressedAt = now();
+                char c;
+                ssize_t n = read(m_fd, &c, 1);
+                if (n == 1)
+                    return true;
+                if (n == 0)
+                {
+                    // Конец ввода (не терминал) - нажатий больше не будет
+                    sleepUntil(deadline);
+                    return false;
+                }
+            }
+        }
+    };
+}
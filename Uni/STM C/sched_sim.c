@@ -0,0 +1,484 @@
+/* Хост-симулятор планировщика scheduler.c.
+
+   Сборка:
+       gcc -O2 -I host sched_sim.c scheduler.c host/stm32f0xx.c -lm -o sched_sim
+   Запуск:
+       ./sched_sim [lr3|buttons] [секунды] [seed]
+
+   Модельное время идет в микросекундах. Нажатия кнопки SB1 (линия EXTI 4)
+   приходят в случайные моменты (экспоненциальные интервалы, в среднем
+   700 мс). __WFI() продвигает время до ближайшего прерывания - нажатия,
+   сравнения TIM2 или события TIM1 - и вызывает его обработчик, как это
+   сделало бы ядро.
+
+   Время работы кода задано оценками: вход в прерывание и тело каждого
+   обработчика прерывания, а для обработчиков планировщика - таблица
+   costs. Прошивка регистрирует обработчики через переходники
+   (sim_on_event, sim_timer_start), которые перед вызовом обработчика
+   занимают процессор на его время. Прерывание, пришедшее во время работы
+   обработчика планировщика, вытесняет его - обработчик заканчивается
+   позже на время прерывания. Прерывание, пришедшее во время другого
+   прерывания, ждет его окончания (приоритеты не моделируются).
+
+   Сценарии:
+   - lr3: прошивка LR3.1.c целиком (ее main переименован в firmware_main):
+     сдвиг светодиода по таймеру планировщика, ШИМ яркости на прерываниях
+     TIM1 (запрещает режим Stop), подавление дребезга 200 мс;
+   - buttons: только кнопка, таймеров нет кроме подавления дребезга -
+     между нажатиями ядро уходит в Stop.
+
+   В конце печатается задержка от нажатия до начала обработчика SB1 в
+   sched_run(): вход в прерывание (и выход из Stop), обработчик EXTI и
+   ожидание прерываний и обработчиков, занимавших процессор в момент
+   нажатия. Печатается и доля времени, проведенная в WFI. */
+#include <stm32f0xx.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scheduler.h"
+
+/* Обработчики прерываний из scheduler.c */
+void EXTI4_15_IRQHandler(void);
+void TIM2_IRQHandler(void);
+
+static void sim_on_event(uint32_t mask, sched_fn_t fn);
+static int sim_timer_start(sched_fn_t fn, uint32_t delay_ms, uint32_t period_ms);
+
+#define main firmware_main
+#define sched_on_event sim_on_event
+#define sched_timer_start sim_timer_start
+#include "LR3.1.c"
+#undef sched_timer_start
+#undef sched_on_event
+#undef main
+
+/* Вход в прерывание Cortex-M0: 16 тактов при 8 МГц */
+#define ENTRY_US        2.0
+/* Выход из режима Stop (tWUSTOP, регулятор в режиме пониженного потребления) */
+#define STOP_WAKEUP_US  5.0
+/* Тела обработчиков прерываний вместе с выходом из них: exti_dispatch
+   перебирает 16 линий, TIM2_IRQHandler только выставляет событие,
+   обработчики TIM1 переписывают порты светодиодов */
+#define EXTI_ISR_US     12.0
+#define TIM2_ISR_US     2.0
+#define TIM1_ISR_US     4.0
+
+static double sim_us = 0;      /* модельное время */
+static double tim2_us = 0;     /* время, насчитанное TIM2 (стоит в режиме Stop) */
+static double tim2_hit = -1;   /* момент совпадения с CCR1, прерывание еще не доставлено */
+static double end_us = 0;
+static double next_press = 0;  /* момент следующего нажатия */
+static double mean_press_ms = 700;
+
+/* TIM1 считает от 0 до ARR с частотой 8 МГц / (PSC + 1). Новый PSC
+   действует с очередного переполнения. В режиме Stop TIM1 стоит, но
+   прошивка с ШИМ в Stop не уходит */
+static double tim1_start = -1; /* начало текущего периода (-1 - таймер выключен) */
+static double tim1_tick = 0;   /* длительность одного счета, мкс */
+static int tim1_cc_done = 0;   /* сравнение в этом периоде уже было */
+
+static double press_at = -1;   /* момент нажатия, ожидающего обработки */
+static double press_min = 0;   /* задержка этого нажатия без ожидания */
+static double irq_at = 0;      /* момент начала последнего прерывания */
+static double isr_us = 0;      /* время, проведенное в прерываниях */
+
+/* Статистика */
+static double idle_us = 0;
+static double lat_sum = 0, lat_max = 0;
+static long lat_cnt = 0, lat_waited = 0, presses = 0, suppressed = 0;
+static long sleeps = 0, stops = 0;
+static long irqs[4];
+
+/* Источники прерываний */
+enum { IRQ_PRESS, IRQ_TIM2, IRQ_TIM1_UP, IRQ_TIM1_CC };
+static const char* irq_names[] = { "EXTI4 (SB1)", "TIM2 compare", "TIM1 update", "TIM1 compare" };
+
+static void sim_busy(double us);
+
+/* Обработчики сценария buttons */
+
+static void btn_unmask(void)
+{
+    sched_exti_enable(4, 1);
+}
+
+static void btn_press(void)
+{
+    sched_exti_enable(4, 0);
+    sim_timer_start(btn_unmask, DEBOUNCE_MS, 0);
+}
+
+/* Время обработчиков планировщика, мкс (оценки при 8 МГц) */
+static const struct
+{
+    sched_fn_t fn;
+    const char* name;
+    double us;
+} costs[] = {
+    { led_shift,  "led_shift",  3 },
+    { on_sb1,     "on_sb1",     8 },
+    { sb1_unmask, "sb1_unmask", 4 },
+    { on_sb2,     "on_sb2",     8 },
+    { sb2_unmask, "sb2_unmask", 4 },
+    { on_sw,      "on_sw",      15 },
+    { btn_press,  "btn_press",  8 },
+    { btn_unmask, "btn_unmask", 4 },
+};
+#define COSTS  (sizeof costs / sizeof costs[0])
+
+static long calls[COSTS];
+static sched_fn_t sb1_fn = 0;  /* обработчик события SB1 */
+
+/* Вызов обработчика планировщика: он занимает процессор, затем делает
+   свое дело. Задержка нажатия считается до его начала */
+static void run_handler(int i)
+{
+    if (costs[i].fn == sb1_fn && press_at >= 0)
+    {
+        double lat = sim_us - press_at;
+        lat_sum += lat;
+        if (lat > lat_max)
+        {
+            lat_max = lat;
+        }
+        if (lat > press_min + 1e-6)
+        {
+            lat_waited++;
+        }
+        lat_cnt++;
+        press_at = -1;
+    }
+
+    calls[i]++;
+    sim_busy(costs[i].us);
+    costs[i].fn();
+}
+
+/* Переходник на каждую строку costs */
+#define TRAMPOLINE(i) static void trampoline##i(void) { run_handler(i); }
+TRAMPOLINE(0) TRAMPOLINE(1) TRAMPOLINE(2) TRAMPOLINE(3)
+TRAMPOLINE(4) TRAMPOLINE(5) TRAMPOLINE(6) TRAMPOLINE(7)
+
+static const sched_fn_t trampolines[] = {
+    trampoline0, trampoline1, trampoline2, trampoline3,
+    trampoline4, trampoline5, trampoline6, trampoline7
+};
+_Static_assert(COSTS <= sizeof trampolines / sizeof trampolines[0], "a trampoline for every handler");
+
+static sched_fn_t wrap(sched_fn_t fn)
+{
+    for (size_t i = 0; i < COSTS; i++)
+    {
+        if (costs[i].fn == fn)
+        {
+            return trampolines[i];
+        }
+    }
+
+    fprintf(stderr, "no cost estimate for a scheduler handler\n");
+    exit(1);
+}
+
+static void sim_on_event(uint32_t mask, sched_fn_t fn)
+{
+    if (mask & SCHED_EVT(0))
+    {
+        sb1_fn = fn;
+    }
+    sched_on_event(mask, wrap(fn));
+}
+
+static int sim_timer_start(sched_fn_t fn, uint32_t delay_ms, uint32_t period_ms)
+{
+    return sched_timer_start(wrap(fn), delay_ms, period_ms);
+}
+
+static double uniform(void)
+{
+    return (rand() + 1.0) / ((double)RAND_MAX + 2.0);
+}
+
+static void schedule_press(void)
+{
+    next_press += -log(uniform()) * mean_press_ms * 1000.0;
+}
+
+/* Совпадение с CCR1, пройденное, пока процессор был занят другим
+   прерыванием, остается в ожидании, как флаг CC1IF */
+static void set_time(double t, int stopped)
+{
+    if (!stopped)
+    {
+        double at_us = (double)TIM2->CCR1 * 1000.0;
+        if (tim2_hit < 0 && (TIM2->DIER & TIM_DIER_CC1IE) && tim2_us < at_us && at_us <= tim2_us + (t - sim_us))
+        {
+            tim2_hit = sim_us + (at_us - tim2_us);
+        }
+        tim2_us += t - sim_us;
+    }
+    sim_us = t;
+    TIM2->CNT = (uint32_t)(tim2_us / 1000.0);
+}
+
+/* Момент ближайшего сравнения TIM2 в модельном времени (или -1) */
+static double next_compare(void)
+{
+    if (!(TIM2->DIER & TIM_DIER_CC1IE))
+    {
+        return -1;
+    }
+    if (tim2_hit >= 0)
+    {
+        return tim2_hit;
+    }
+
+    double at_us = (double)TIM2->CCR1 * 1000.0;
+    if (at_us <= tim2_us)
+    {
+        return -1;
+    }
+    return sim_us + (at_us - tim2_us);
+}
+
+/* Новый период TIM1, начинающийся в момент t */
+static void tim1_period(double t)
+{
+    tim1_start = t;
+    tim1_tick = (TIM1->PSC + 1) / 8.0;
+    tim1_cc_done = 0;
+}
+
+/* Ближайшее событие TIM1 раньше *t: переполнение или сравнение */
+static void next_tim1(double* t, int* src)
+{
+    if (!(TIM1->CR1 & TIM_CR1_CEN))
+    {
+        tim1_start = -1;
+        return;
+    }
+    if (tim1_start < 0)
+    {
+        tim1_period(sim_us);
+    }
+
+    if (!tim1_cc_done && (TIM1->DIER & TIM_DIER_CC1IE) && TIM1->CCR1 <= TIM1->ARR)
+    {
+        double cc = tim1_start + TIM1->CCR1 * tim1_tick;
+        if (cc < *t)
+        {
+            *t = cc;
+            *src = IRQ_TIM1_CC;
+        }
+    }
+
+    double up = tim1_start + (TIM1->ARR + 1) * tim1_tick;
+    if (up < *t)
+    {
+        *t = up;
+        *src = IRQ_TIM1_UP;
+    }
+}
+
+/* Вход в прерывание, пришедшее в момент t: если процессор еще занят
+   другим прерыванием, оно ждет его окончания */
+static void enter(double t, int stopped)
+{
+    set_time(t > sim_us ? t : sim_us, stopped);
+    irq_at = sim_us;
+    set_time(sim_us + ENTRY_US + (stopped ? STOP_WAKEUP_US : 0), 0);
+}
+
+/* Доставка ближайшего прерывания не позже limit. Возвращает 0, если
+   прерываний до limit нет, 1 - если прерывание обработано, 2 - если
+   нажатие пришло на запрещенную линию и ядро не проснулось */
+static int deliver(double limit, int stopped)
+{
+    double t = next_press;
+    int src = IRQ_PRESS;
+
+    if (!stopped)
+    {
+        double cmp = next_compare();
+        if (cmp >= 0 && cmp < t)
+        {
+            t = cmp;
+            src = IRQ_TIM2;
+        }
+        next_tim1(&t, &src);
+    }
+
+    if (t > limit)
+    {
+        return 0;
+    }
+
+    double busy_from;
+    switch (src)
+    {
+    case IRQ_PRESS:
+        schedule_press();
+        presses++;
+        if (!(EXTI->IMR & (1U << 4)))
+        {
+            /* Линия запрещена на время подавления дребезга */
+            set_time(t > sim_us ? t : sim_us, stopped);
+            suppressed++;
+            return 2;
+        }
+
+        enter(t, stopped);
+        busy_from = irq_at;
+        if (press_at < 0)
+        {
+            press_at = t;
+            press_min = ENTRY_US + (stopped ? STOP_WAKEUP_US : 0) + EXTI_ISR_US;
+        }
+        EXTI->PR |= (1U << 4);
+        EXTI4_15_IRQHandler();
+        set_time(sim_us + EXTI_ISR_US, 0);
+        break;
+
+    case IRQ_TIM2:
+        tim2_hit = -1;
+        enter(t, 0);
+        busy_from = irq_at;
+        TIM2->SR |= TIM_SR_CC1IF;
+        TIM2_IRQHandler();
+        set_time(sim_us + TIM2_ISR_US, 0);
+        break;
+
+    case IRQ_TIM1_UP:
+        tim1_period(t);
+        enter(t, 0);
+        busy_from = irq_at;
+        TIM1->SR |= TIM_SR_UIF;
+        TIM1_BRK_UP_TRG_COM_IRQHandler();
+        set_time(sim_us + TIM1_ISR_US, 0);
+        break;
+
+    default:
+        tim1_cc_done = 1;
+        enter(t, 0);
+        busy_from = irq_at;
+        TIM1->SR |= TIM_SR_CC1IF;
+        TIM1_CC_IRQHandler();
+        set_time(sim_us + TIM1_ISR_US, 0);
+        break;
+    }
+
+    irqs[src]++;
+    isr_us += sim_us - busy_from;
+    return 1;
+}
+
+static void report(void)
+{
+    printf("simulated:        %.1f s\n", sim_us / 1e6);
+    printf("presses:          %ld (%ld suppressed by debounce)\n", presses, suppressed);
+    printf("interrupts:      ");
+    for (int i = 0; i < 4; i++)
+    {
+        if (irqs[i] > 0)
+        {
+            printf(" %s %ld,", irq_names[i], irqs[i]);
+        }
+    }
+    printf(" %.3f%% of the time\n", 100.0 * isr_us / sim_us);
+    printf("handler calls:   ");
+    for (size_t i = 0; i < COSTS; i++)
+    {
+        if (calls[i] > 0)
+        {
+            printf(" %s %ld", costs[i].name, calls[i]);
+        }
+    }
+    printf("\n");
+    printf("WFI entries:      %ld sleep, %ld stop\n", sleeps, stops);
+    printf("idle fraction:    %.4f%%\n", 100.0 * idle_us / sim_us);
+    if (lat_cnt > 0)
+    {
+        printf("wake-up latency:  mean %.2f us, max %.2f us (%ld events, %ld waited for other work)\n",
+               lat_sum / lat_cnt, lat_max, lat_cnt, lat_waited);
+    }
+}
+
+/* Ядро "спит" до ближайшего прерывания */
+void __WFI(void)
+{
+    int stopped = (SCB->SCR & SCB_SCR_SLEEPDEEP_Msk) != 0;
+    double from = sim_us;
+
+    if (stopped)
+    {
+        stops++;
+    }
+    else
+    {
+        sleeps++;
+    }
+
+    int r;
+    while ((r = deliver(end_us, stopped)) == 2)
+    {
+    }
+
+    if (r == 0)
+    {
+        /* Прерываний до конца модели нет */
+        idle_us += end_us - from;
+        set_time(end_us, stopped);
+        report();
+        exit(0);
+    }
+
+    /* Простоем считается время до прихода прерывания, без входа в него */
+    idle_us += irq_at - from;
+    if (sim_us >= end_us)
+    {
+        report();
+        exit(0);
+    }
+}
+
+/* Обработчик занимает процессор us микросекунд. Прерывания, пришедшие за
+   это время, вытесняют его, и он заканчивается позже на их время */
+static void sim_busy(double us)
+{
+    double until = sim_us + us;
+    double before = isr_us;
+    while (deliver(until, 0))
+    {
+        until += isr_us - before;
+        before = isr_us;
+    }
+    set_time(until, 0);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* mode = argc > 1 ? argv[1] : "lr3";
+    double seconds = argc > 2 ? atof(argv[2]) : 60.0;
+    unsigned seed = argc > 3 ? (unsigned)atoi(argv[3]) : 1;
+
+    srand(seed);
+    end_us = seconds * 1e6;
+    schedule_press();
+
+    if (strcmp(mode, "lr3") == 0)
+    {
+        printf("scenario:         %s\n", mode);
+        firmware_main();
+    }
+    else if (strcmp(mode, "buttons") == 0)
+    {
+        printf("scenario:         %s\n", mode);
+        sched_init();
+        sched_exti(4, SCHED_PORT_B, SCHED_EDGE_FALLING, EVT_SB1);
+        sim_on_event(EVT_SB1, btn_press);
+        sched_run();
+    }
+
+    fprintf(stderr, "usage: %s [lr3|buttons] [seconds] [seed]\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,355 @@
+#include <stm32f0xx.h>
+#include "scheduler.h"
+
+/* Событие планировщика: сработало сравнение TIM2 (наступил срок таймера) */
+#define SCHED_EVT_TIMER  (1UL << 31)
+
+/* Программный таймер */
+typedef struct
+{
+    sched_fn_t fn;        /* обработчик */
+    uint32_t   deadline;  /* срок срабатывания, мс */
+    uint32_t   period;    /* период, мс (0 - однократный) */
+    uint8_t    active;
+} sched_timer_t;
+
+/* Обработчик событий */
+typedef struct
+{
+    uint32_t   mask;
+    sched_fn_t fn;
+} sched_handler_t;
+
+static sched_timer_t timers[SCHED_MAX_TIMERS];
+static sched_handler_t handlers[SCHED_MAX_HANDLERS];
+static uint8_t handler_cnt = 0;
+
+/* События, выставленные из прерываний и еще не обработанные */
+static volatile uint32_t pending = 0;
+/* Количество запретов режима Stop */
+static volatile uint8_t stop_locks = 0;
+
+/* Сравнение сроков с учетом переполнения 32-битного счетчика */
+static int expired(uint32_t deadline, uint32_t now)
+{
+    return (int32_t)(deadline - now) <= 0;
+}
+
+void sched_init(void)
+{
+    /* Включение тактирования TIM2 и блока управления питанием */
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+    RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+
+    /* Частота МК 8 МГц, предделитель 8000 - счетчик увеличивается каждую 1 мс */
+    TIM2->PSC = 8000 - 1;
+    /* Счет по всему 32-битному диапазону, без прерываний по переполнению */
+    TIM2->ARR = 0xFFFFFFFF;
+    /* Загрузка предделителя */
+    TIM2->EGR = TIM_EGR_UG;
+    TIM2->SR = 0;
+    TIM2->CR1 |= TIM_CR1_CEN;
+
+    /* Сроки таймеров менее срочны, чем кнопки и USART */
+    NVIC_SetPriority(TIM2_IRQn, 1);
+    NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+uint32_t sched_now(void)
+{
+    return TIM2->CNT;
+}
+
+/* Настройка канала сравнения TIM2 на ближайший срок */
+static void arm(void)
+{
+    uint32_t now = sched_now();
+    uint8_t found = 0;
+    uint32_t next = 0;
+
+    for (int i = 0; i < SCHED_MAX_TIMERS; i++)
+    {
+        if (timers[i].active && (!found || (int32_t)(timers[i].deadline - next) < 0))
+        {
+            next = timers[i].deadline;
+            found = 1;
+        }
+    }
+
+    if (!found)
+    {
+        /* Сроков нет - прерывание по сравнению не нужно */
+        TIM2->DIER &= ~TIM_DIER_CC1IE;
+        return;
+    }
+
+    TIM2->CCR1 = next;
+    TIM2->DIER |= TIM_DIER_CC1IE;
+
+    /* Если срок уже прошел, сравнение не сработает - выставляем событие сами */
+    if (expired(next, now) || expired(next, sched_now()))
+    {
+        sched_post(SCHED_EVT_TIMER);
+    }
+}
+
+int sched_timer_start(sched_fn_t fn, uint32_t delay_ms, uint32_t period_ms)
+{
+    for (int i = 0; i < SCHED_MAX_TIMERS; i++)
+    {
+        if (!timers[i].active)
+        {
+            timers[i].fn = fn;
+            timers[i].deadline = sched_now() + delay_ms;
+            timers[i].period = period_ms;
+            timers[i].active = 1;
+            arm();
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void sched_timer_stop(int id)
+{
+    if (id < 0 || id >= SCHED_MAX_TIMERS)
+    {
+        return;
+    }
+
+    timers[id].active = 0;
+    arm();
+}
+
+void sched_timer_period(int id, uint32_t period_ms)
+{
+    if (id < 0 || id >= SCHED_MAX_TIMERS)
+    {
+        return;
+    }
+
+    timers[id].period = period_ms;
+}
+
+void sched_on_event(uint32_t mask, sched_fn_t fn)
+{
+    if (handler_cnt < SCHED_MAX_HANDLERS)
+    {
+        handlers[handler_cnt].mask = mask;
+        handlers[handler_cnt].fn = fn;
+        handler_cnt++;
+    }
+}
+
+void sched_post(uint32_t events)
+{
+    __disable_irq();
+    pending |= events;
+    __enable_irq();
+}
+
+void sched_stop_lock(void)
+{
+    stop_locks++;
+}
+
+void sched_stop_unlock(void)
+{
+    if (stop_locks > 0)
+    {
+        stop_locks--;
+    }
+}
+
+/* События линий EXTI (индекс - номер линии) */
+static uint32_t exti_events[16];
+
+void sched_exti(uint8_t line, uint8_t port, uint8_t edges, uint32_t events)
+{
+    /* Включение тактирования SYSCFG для выбора порта линии */
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+
+    /* Выбор порта: 4 бита на линию, 4 линии в регистре */
+    SYSCFG->EXTICR[line / 4] &= ~(0xFU << ((line % 4) * 4));
+    SYSCFG->EXTICR[line / 4] |= ((uint32_t)port << ((line % 4) * 4));
+
+    if (edges & SCHED_EDGE_FALLING)
+    {
+        EXTI->FTSR |= (1U << line);
+    }
+    if (edges & SCHED_EDGE_RISING)
+    {
+        EXTI->RTSR |= (1U << line);
+    }
+
+    exti_events[line] = events;
+    EXTI->IMR |= (1U << line);
+
+    /* Линии 0-1, 2-3 и 4-15 обслуживаются разными векторами */
+    if (line < 2)
+    {
+        NVIC_EnableIRQ(EXTI0_1_IRQn);
+    }
+    else if (line < 4)
+    {
+        NVIC_EnableIRQ(EXTI2_3_IRQn);
+    }
+    else
+    {
+        NVIC_EnableIRQ(EXTI4_15_IRQn);
+    }
+}
+
+void sched_exti_enable(uint8_t line, uint8_t on)
+{
+    if (on)
+    {
+        /* Сброс флага, выставленного дребезгом, пока линия была запрещена */
+        EXTI->PR = (1U << line);
+        EXTI->IMR |= (1U << line);
+    }
+    else
+    {
+        EXTI->IMR &= ~(1U << line);
+    }
+}
+
+/* Общая часть обработчиков прерываний EXTI */
+static void exti_dispatch(uint32_t lines)
+{
+    uint32_t pr = EXTI->PR & lines;
+    uint32_t events = 0;
+
+    /* Сброс флагов записью единицы */
+    EXTI->PR = pr;
+
+    for (int i = 0; i < 16; i++)
+    {
+        if (pr & (1U << i))
+        {
+            events |= exti_events[i];
+        }
+    }
+
+    sched_post(events);
+}
+
+void EXTI0_1_IRQHandler(void)
+{
+    exti_dispatch(0x0003);
+}
+
+void EXTI2_3_IRQHandler(void)
+{
+    exti_dispatch(0x000C);
+}
+
+void EXTI4_15_IRQHandler(void)
+{
+    exti_dispatch(0xFFF0);
+}
+
+/* Прерывание по сравнению TIM2 - наступил ближайший срок */
+void TIM2_IRQHandler(void)
+{
+    TIM2->SR &= ~TIM_SR_CC1IF;
+    sched_post(SCHED_EVT_TIMER);
+}
+
+/* Вызов обработчиков таймеров, срок которых наступил */
+static void run_timers(void)
+{
+    uint32_t now = sched_now();
+
+    for (int i = 0; i < SCHED_MAX_TIMERS; i++)
+    {
+        if (!timers[i].active || !expired(timers[i].deadline, now))
+        {
+            continue;
+        }
+
+        if (timers[i].period)
+        {
+            /* Следующий срок отсчитывается от предыдущего, а не от текущего
+               времени, чтобы период не "уплывал". Пропущенные сроки не
+               навёрстываются */
+            timers[i].deadline += timers[i].period;
+            if (expired(timers[i].deadline, now))
+            {
+                timers[i].deadline = now + timers[i].period;
+            }
+        }
+        else
+        {
+            timers[i].active = 0;
+        }
+
+        timers[i].fn();
+    }
+
+    arm();
+}
+
+/* Переход в режим пониженного потребления до ближайшего прерывания */
+static void idle(void)
+{
+    uint8_t have_timers = 0;
+
+    for (int i = 0; i < SCHED_MAX_TIMERS; i++)
+    {
+        have_timers |= timers[i].active;
+    }
+
+    if (!have_timers && stop_locks == 0)
+    {
+        /* Режим Stop: тактирование остановлено, регулятор в режиме
+           пониженного потребления. Разбудить может только линия EXTI */
+        PWR->CR |= PWR_CR_LPDS;
+        SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+        __WFI();
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+    }
+    else
+    {
+        /* Режим Sleep: ядро остановлено, TIM2 продолжает счет */
+        __WFI();
+    }
+}
+
+void sched_run(void)
+{
+    while (1)
+    {
+        uint32_t events;
+
+        /* Забираем накопленные события атомарно */
+        __disable_irq();
+        events = pending;
+        pending = 0;
+        __enable_irq();
+
+        for (int i = 0; i < handler_cnt; i++)
+        {
+            if (events & handlers[i].mask)
+            {
+                handlers[i].fn();
+            }
+        }
+
+        if (events & SCHED_EVT_TIMER)
+        {
+            run_timers();
+        }
+
+        /* Прерывания запрещены между проверкой и WFI: прерывание, пришедшее
+           в этот момент, не потеряется - WFI сразу завершится, а обработчик
+           выполнится после __enable_irq() */
+        __disable_irq();
+        if (pending == 0)
+        {
+            idle();
+        }
+        __enable_irq();
+    }
+}
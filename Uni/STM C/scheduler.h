@@ -0,0 +1,78 @@
+/* Кооперативный планировщик событий для лабораторных программ STM32F0.
+
+   Вместо опроса регистров IDR в бесконечном цикле и счета миллисекунд в
+   прерывании таймера программа регистрирует:
+   - программные таймеры (однократные и периодические) со сроком в мс;
+   - обработчики событий, которые выставляются из прерываний (EXTI, USART).
+   Когда делать нечего, sched_run() усыпляет ядро командой WFI. Если нет ни
+   одного активного таймера и никто не запретил глубокий сон, ядро уходит в
+   режим Stop и просыпается только по линии EXTI.
+
+   Время отсчитывает 32-битный TIM2 с частотой 1 кГц без периодических
+   прерываний: прерывание по сравнению (канал 1) настраивается только на
+   ближайший срок. */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/* Максимальное количество программных таймеров */
+#define SCHED_MAX_TIMERS    8
+
+/* Максимальное количество обработчиков событий */
+#define SCHED_MAX_HANDLERS  8
+
+/* Бит события с номером n (0 - 30). Бит 31 занят самим планировщиком */
+#define SCHED_EVT(n)        (1UL << (n))
+
+/* Фронты срабатывания линии EXTI */
+#define SCHED_EDGE_FALLING  0x1
+#define SCHED_EDGE_RISING   0x2
+
+/* Порты для sched_exti() */
+#define SCHED_PORT_A        0
+#define SCHED_PORT_B        1
+#define SCHED_PORT_C        2
+
+typedef void (*sched_fn_t)(void);
+
+/* Инициализация TIM2 как источника времени */
+void sched_init(void);
+
+/* Текущее время в мс */
+uint32_t sched_now(void);
+
+/* Запуск таймера: fn вызывается через delay_ms, затем каждые period_ms
+   (period_ms = 0 - однократный таймер). Возвращает номер таймера или -1 */
+int sched_timer_start(sched_fn_t fn, uint32_t delay_ms, uint32_t period_ms);
+
+/* Остановка таймера */
+void sched_timer_stop(int id);
+
+/* Смена периода работающего таймера. Новый период действует со
+   следующего срабатывания */
+void sched_timer_period(int id, uint32_t period_ms);
+
+/* Регистрация обработчика для событий из маски mask */
+void sched_on_event(uint32_t mask, sched_fn_t fn);
+
+/* Выставление событий. Можно вызывать из прерываний */
+void sched_post(uint32_t events);
+
+/* Настройка линии EXTI line (она же номер вывода) порта port на
+   выставление событий events по указанным фронтам */
+void sched_exti(uint8_t line, uint8_t port, uint8_t edges, uint32_t events);
+
+/* Разрешение/запрет прерывания линии EXTI (например, на время подавления
+   дребезга) */
+void sched_exti_enable(uint8_t line, uint8_t on);
+
+/* Запрет/разрешение режима Stop. Программа, которой нужна тактируемая
+   периферия (ШИМ на TIM1, прием USART), держит запрет */
+void sched_stop_lock(void);
+void sched_stop_unlock(void);
+
+/* Главный цикл планировщика. Не возвращает управление */
+__attribute__((noreturn)) void sched_run(void);
+
+#endif
@@ -0,0 +1,285 @@
+/* Хост-симулятор USART2 для консоли CT/CR из lr4.2.txt.
+
+   Сборка:
+       gcc -O2 -I host usart_sim.c host/stm32f0xx.c -o usart_sim
+   Запуск:
+       ./usart_sim [команд] [пауза между командами, мс]
+
+   Прошивка lr4.2.txt включается в этот файл целиком (ее main переименован
+   в firmware_main), поэтому симулятор видит ее очереди. Модельное время
+   идет в микросекундах, линия - 9600 бод, 8N1, то есть 1.04 мс на байт.
+
+   "Терминал" шлет команды CT и CR (и изредка неизвестную команду), не
+   дожидаясь ответа, с паузой между командами (по умолчанию 5 мс; 0 - как
+   при вставке текста). Ответы длиннее команд, поэтому при длинной серии
+   без пауз очередь ответов отстает от приема, и в конце концов переполняется
+   кольцевой буфер приема - симулятор это покажет.
+
+   Передатчик моделируется как в STM32: запись в TDR сбрасывает TXE, байт
+   уходит в сдвиговый регистр, когда тот свободен, и через время байта
+   линия снова свободна. Принятый байт, пришедший при взведенном RXNE, теряется
+   (переполнение). Чтение RDR на хосте не отследить, поэтому RXNE
+   сбрасывается после вызова обработчика, взявшего байт.
+
+   В конце вывод сравнивается с ожидаемым, печатаются потерянные байты,
+   задержка ответа (от CR команды до первого байта ответа на линии) и
+   сколько байтов команд пришло, пока передатчик был занят предыдущим
+   ответом. */
+#include <stm32f0xx.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define main firmware_main
+#include "lr4.2.txt"
+#undef main
+
+/* Время одного байта: старт, 8 бит данных, стоп */
+#define BYTE_US     (10 * 1e6 / 9600)
+/* TDR пуст (в TDR помещается 9 бит, такое значение прошивка не запишет) */
+#define TDR_EMPTY   0xFFFFFFFFU
+
+#define MAX_SCRIPT  65536
+
+static double sim_us = 0;
+static double shift_end_us = -1;  /* конец передачи байта (-1 - линия свободна) */
+
+/* Вход: байты терминала и момент прихода следующего */
+static char script[MAX_SCRIPT];
+static size_t script_len = 0, script_pos = 0;
+static double rx_next_us = 0;
+static double gap_us = 0;
+
+/* Ожидаемые ответы и моменты CR соответствующих команд */
+static char expected[MAX_SCRIPT];
+static size_t expected_len = 0;
+static size_t reply_end[MAX_SCRIPT / 3];
+static double reply_cmd_us[MAX_SCRIPT / 3];
+static size_t replies = 0;
+
+/* Вывод прошивки */
+static char output[MAX_SCRIPT];
+static size_t output_len = 0;
+static size_t reply_done = 0;
+
+/* Статистика */
+static long overruns = 0;
+static long rx_while_tx = 0;
+static double lat_sum = 0, lat_max = 0;
+static int max_rx_depth = 0;
+
+static void expect(const char* text, double cmd_us)
+{
+    size_t len = strlen(text);
+    memcpy(expected + expected_len, text, len);
+    expected_len += len;
+    reply_end[replies] = expected_len;
+    reply_cmd_us[replies] = cmd_us;
+    replies++;
+}
+
+/* Сценарий и ожидаемые ответы. Момент прихода каждого байта известен
+   заранее: байты идут подряд, между командами - пауза gap_us */
+static void build_script(int commands)
+{
+    static const char* words[16] = {
+        "ZERO", "ONE", "TWO", "THREE", "FOUR", "FIVE", "SIX", "SEVEN",
+        "EIGHT", "NINE", "TEN", "ELEVEN", "TWELVE", "THIRTEEN", "FOURTEEN", "FIFTEEN"
+    };
+    int counter = 0;
+    double t = 0;
+    char text[16];
+
+    for (int i = 0; i < commands && script_len + 4 < MAX_SCRIPT && expected_len + 16 < MAX_SCRIPT; i++)
+    {
+        const char* cmd = (i % 7 == 6) ? "XY\r" : (i % 3 == 2) ? "CR\r" : "CT\r";
+        size_t len = strlen(cmd);
+
+        memcpy(script + script_len, cmd, len);
+        script_len += len;
+        t += len * BYTE_US;
+
+        /* Байт CR команды приходит в момент t */
+        if (cmd[0] == 'C' && cmd[1] == 'T')
+        {
+            counter = (counter + 1) % 16;
+            snprintf(text, sizeof text, "%s", words[counter]);
+            expect(text, t);
+        }
+        else if (cmd[0] == 'C' && cmd[1] == 'R')
+        {
+            snprintf(text, sizeof text, "%c", '0' + counter);
+            expect(text, t);
+        }
+        t += gap_us;
+    }
+}
+
+/* Реакция USART на записи прошивки в регистры */
+static void line_update(void)
+{
+    if (USART2->TDR != TDR_EMPTY && shift_end_us < 0)
+    {
+        /* Байт переходит в сдвиговый регистр и начинает уходить в линию */
+        if (output_len < MAX_SCRIPT)
+        {
+            output[output_len++] = (char)USART2->TDR;
+        }
+        if (reply_done < replies && output_len == (reply_done ? reply_end[reply_done - 1] : 0) + 1)
+        {
+            double lat = sim_us - reply_cmd_us[reply_done];
+            lat_sum += lat;
+            if (lat > lat_max)
+            {
+                lat_max = lat;
+            }
+        }
+        if (reply_done < replies && output_len == reply_end[reply_done])
+        {
+            reply_done++;
+        }
+
+        USART2->TDR = TDR_EMPTY;
+        shift_end_us = sim_us + BYTE_US;
+    }
+
+    if (USART2->TDR == TDR_EMPTY)
+    {
+        USART2->ISR |= USART_ISR_TXE;
+    }
+    else
+    {
+        USART2->ISR &= ~USART_ISR_TXE;
+    }
+
+    if (USART2->TDR == TDR_EMPTY && shift_end_us < 0)
+    {
+        USART2->ISR |= USART_ISR_TC;
+    }
+    else
+    {
+        USART2->ISR &= ~USART_ISR_TC;
+    }
+}
+
+static int irq_pending(void)
+{
+    return ((USART2->CR1 & USART_CR1_RXNEIE) && (USART2->ISR & USART_ISR_RXNE)) ||
+           ((USART2->CR1 & USART_CR1_TXEIE) && (USART2->ISR & USART_ISR_TXE));
+}
+
+static void report(void)
+{
+    int ok = output_len == expected_len && memcmp(output, expected, expected_len) == 0;
+
+    printf("commands:         %zu bytes, %zu responses\n", script_len, replies);
+    printf("line time:        %.1f ms\n", sim_us / 1000.0);
+    printf("output:           %s (%zu of %zu bytes)\n", ok ? "matches" : "MISMATCH", output_len, expected_len);
+    printf("rx overruns:      %ld, dropped by firmware: %u\n", overruns, (unsigned)rx_dropped);
+    printf("rx during tx:     %ld bytes accepted while a response was going out\n", rx_while_tx);
+    printf("rx ring depth:    %d of %d\n", max_rx_depth, RX_SIZE);
+    if (reply_done > 0)
+    {
+        printf("response latency: mean %.2f ms, max %.2f ms\n",
+               lat_sum / reply_done / 1000.0, lat_max / 1000.0);
+    }
+
+    if (!ok)
+    {
+        size_t i = 0;
+        while (i < output_len && i < expected_len && output[i] == expected[i])
+        {
+            i++;
+        }
+        printf("first difference at byte %zu\n", i);
+    }
+    exit(ok && overruns == 0 && rx_dropped == 0 ? 0 : 1);
+}
+
+/* Ядро "спит" до ближайшего прерывания USART2 и вызывает обработчик */
+void __WFI(void)
+{
+    line_update();
+
+    while (!irq_pending())
+    {
+        int rx = script_pos < script_len;
+        int tx = shift_end_us >= 0;
+
+        if (!rx && !tx)
+        {
+            /* Вход исчерпан, линия свободна: модель закончена */
+            report();
+        }
+
+        if (tx && (!rx || shift_end_us <= rx_next_us))
+        {
+            sim_us = shift_end_us;
+            shift_end_us = -1;
+        }
+        else
+        {
+            char ch = script[script_pos++];
+
+            sim_us = rx_next_us;
+            rx_next_us += BYTE_US;
+            if (ch == '\r')
+            {
+                rx_next_us += gap_us;
+            }
+
+            if (USART2->ISR & USART_ISR_RXNE)
+            {
+                overruns++;
+            }
+            else
+            {
+                USART2->RDR = (uint8_t)ch;
+                USART2->ISR |= USART_ISR_RXNE;
+                if (tx)
+                {
+                    rx_while_tx++;
+                }
+            }
+        }
+
+        line_update();
+    }
+
+    int took_rx = (USART2->ISR & USART_ISR_RXNE) != 0;
+    USART2_IRQHandler();
+    if (took_rx)
+    {
+        USART2->ISR &= ~USART_ISR_RXNE;
+    }
+
+    int depth = (uint8_t)(rx_head - rx_tail);
+    if (depth > max_rx_depth)
+    {
+        max_rx_depth = depth;
+    }
+
+    line_update();
+}
+
+int main(int argc, char* argv[])
+{
+    int commands = argc > 1 ? atoi(argv[1]) : 200;
+    gap_us = (argc > 2 ? atof(argv[2]) : 5.0) * 1000.0;
+
+    if (commands <= 0 || gap_us < 0)
+    {
+        fprintf(stderr, "usage: %s [commands] [gap ms]\n", argv[0]);
+        return 1;
+    }
+
+    build_script(commands);
+
+    /* Первый байт приходит через время байта после начала */
+    rx_next_us = BYTE_US;
+    USART2->TDR = TDR_EMPTY;
+    USART2->ISR = USART_ISR_TXE | USART_ISR_TC;
+
+    firmware_main();
+    return 0;
+}
@@ -0,0 +1,138 @@
+# Throughput gate, run in script mode by the bench-gate and bench-baseline
+# targets:
+#   cmake -DBIN_DIR=<build> -DVARIANT=-lto -DBASELINE=<file> -DTOLERANCE=0.15 [-DRUNS=3] [-DUPDATE=ON] -P BenchGate.cmake
+#
+# Every benchmark runs a fixed, single-threaded workload of about two
+# seconds RUNS times and keeps its best throughput, which is the least noisy
+# figure on a shared machine. With UPDATE, or when there is no baseline yet,
+# the results become the baseline; otherwise a result more than TOLERANCE
+# below its baseline fails the gate. The baseline file holds one
+# "<name> <value>" line per benchmark and is only comparable with runs on
+# the machine it was recorded on, so it lives in the build directory.
+cmake_minimum_required(VERSION 3.16)
+
+foreach(var BIN_DIR BASELINE TOLERANCE)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "BenchGate.cmake needs -D${var}=...")
+    endif()
+endforeach()
+
+if(NOT RUNS)
+    set(RUNS 3)
+endif()
+
+# name | program | regex of the throughput in M/s (first group) | arguments
+set(benchmarks
+    "blackjack_tables|BlackJack|([0-9.]+) M hands/s|--seats basic,dealer,safe --tables 2500 --rounds 4000 --threads 1"
+    "blackjack_hands|BlackJack|\n +1 +[0-9.]+ +([0-9.]+)|--scaling 1 --hands 16000000"
+    "rpg_games|RPG|\n +1 +[0-9.]+ +([0-9.]+)|--scaling 1 4000000"
+    "rpg_fast|RPG|compile-time: +[0-9.]+ s, ([0-9.]+) M games/s|--bench 5000000")
+
+# CMake only has integer arithmetic: a decimal number in thousandths
+function(thousandths value out)
+    string(REGEX MATCH "^([0-9]*)\\.?([0-9]*)$" parsed "${value}")
+    set(whole "${CMAKE_MATCH_1}")
+    string(SUBSTRING "${CMAKE_MATCH_2}000" 0 3 fraction)
+    if(whole STREQUAL "")
+        set(whole 0)
+    endif()
+    math(EXPR result "${whole} * 1000 + (1${fraction} - 1000)")
+    set(${out} ${result} PARENT_SCOPE)
+endfunction()
+
+# text right-aligned in width columns
+function(pad text width out)
+    string(LENGTH "${text}" length)
+    set(padded "${text}")
+    if(length LESS width)
+        math(EXPR missing "${width} - ${length}")
+        string(REPEAT " " ${missing} spaces)
+        set(padded "${spaces}${text}")
+    endif()
+    set(${out} "${padded}" PARENT_SCOPE)
+endfunction()
+
+if(NOT EXISTS "${BASELINE}")
+    set(UPDATE ON)
+else()
+    file(STRINGS "${BASELINE}" lines REGEX "^[a-z_]+ [0-9.]+$")
+    foreach(line IN LISTS lines)
+        string(REGEX MATCH "^([a-z_]+) ([0-9.]+)$" parsed "${line}")
+        set(baseline_${CMAKE_MATCH_1} ${CMAKE_MATCH_2})
+    endforeach()
+endif()
+thousandths(${TOLERANCE} limit)
+
+set(failed "")
+set(results "")
+message("variant \"${VARIANT}\", best of ${RUNS}\nbenchmark              M/s  baseline    change")
+foreach(bench IN LISTS benchmarks)
+    string(REPLACE "|" ";" fields "${bench}")
+    list(GET fields 0 name)
+    list(GET fields 1 program)
+    list(GET fields 2 regex)
+    list(GET fields 3 args)
+    separate_arguments(args UNIX_COMMAND "${args}")
+
+    set(exe "${BIN_DIR}/${program}${VARIANT}")
+    if(NOT EXISTS "${exe}")
+        message(FATAL_ERROR "${exe} is not built")
+    endif()
+
+    set(best 0)
+    set(bestValue 0)
+    foreach(run RANGE 1 ${RUNS})
+        execute_process(COMMAND "${exe}" ${args} OUTPUT_VARIABLE out RESULT_VARIABLE status)
+        if(NOT status EQUAL 0 OR NOT out MATCHES "${regex}")
+            message(FATAL_ERROR "${name}: ${program}${VARIANT} ${args} failed (${status}):\n${out}")
+        endif()
+        set(value ${CMAKE_MATCH_1})
+        thousandths(${value} scaled)
+        if(scaled GREATER best)
+            set(best ${scaled})
+            set(bestValue ${value})
+        endif()
+    endforeach()
+    string(APPEND results "${name} ${bestValue}\n")
+
+    string(LENGTH "${name}" length)
+    math(EXPR tail "18 - ${length}")
+    string(REPEAT " " ${tail} spaces)
+    pad("${bestValue}" 8 column)
+    set(line "${name}${spaces}${column}")
+    if(DEFINED baseline_${name})
+        thousandths(${baseline_${name}} base)
+        # change in tenths of a percent
+        math(EXPR change "(${best} - ${base}) * 1000 / ${base}")
+        set(sign "+")
+        set(magnitude ${change})
+        if(change LESS 0)
+            set(sign "-")
+            math(EXPR magnitude "-${change}")
+        endif()
+        math(EXPR whole "${magnitude} / 10")
+        math(EXPR tenth "${magnitude} % 10")
+        pad("${baseline_${name}}" 10 baseColumn)
+        pad("${sign}${whole}.${tenth}%" 10 changeColumn)
+        string(APPEND line "${baseColumn}${changeColumn}")
+        if(change LESS -${limit})
+            string(APPEND line "  REGRESSION")
+            list(APPEND failed ${name})
+        endif()
+    else()
+        string(APPEND line "        (none)")
+    endif()
+    message("${line}")
+endforeach()
+
+if(UPDATE)
+    file(WRITE "${BASELINE}"
+        "# Best of ${RUNS} single-threaded runs of every bench-gate benchmark, in\n"
+        "# millions of hands or games per second. The numbers belong to the\n"
+        "# machine they were recorded on; re-record them there with\n"
+        "# cmake --build <build> --target bench-baseline\n"
+        "${results}")
+    message("baseline written to ${BASELINE}")
+elseif(failed)
+    message(FATAL_ERROR "throughput more than ${TOLERANCE} below the baseline: ${failed}")
+endif()